@@ -3,7 +3,10 @@
 #include <string.h>
 #include <stdio.h>
 #include "devices/ide.h"
+#include "devices/timer.h"
+#include "threads/interrupt.h"
 #include "threads/malloc.h"
+#include "threads/trace.h"
 
 /* A block device. */
 struct block
@@ -17,8 +20,8 @@ struct block
     const struct block_operations *ops;  /* Driver operations. */
     void *aux;                          /* Extra data owned by driver. */
 
-    unsigned long long read_cnt;        /* Number of sectors read. */
-    unsigned long long write_cnt;       /* Number of sectors written. */
+    struct block_stats stats;           /* I/O statistics. */
+    block_sector_t next_sector;         /* Sector after the last request. */
   };
 
 /* List of all block devices. */
@@ -113,6 +116,132 @@ check_sector (struct block *block, block_sector_t sector)
     }
 }
 
+/* Notes that a request for CNT sectors starting at SECTOR has
+   been submitted to BLOCK, and returns the time of submission
+   per timer_usecs(). */
+static int64_t
+request_begin (struct block *block, block_sector_t sector, size_t cnt)
+{
+  struct block_stats *s = &block->stats;
+  enum intr_level old_level = intr_disable ();
+
+  if (++s->in_flight > s->max_in_flight)
+    s->max_in_flight = s->in_flight;
+  if (sector == block->next_sector)
+    s->seq_cnt++;
+  else
+    s->random_cnt++;
+  block->next_sector = sector + cnt;
+  intr_set_level (old_level);
+
+  return timer_usecs ();
+}
+
+/* Returns the histogram bucket for a latency of US
+   microseconds. */
+static int
+hist_bucket (int64_t us)
+{
+  int bucket = 0;
+
+  while (us >= 2 && bucket < BLOCK_HIST_CNT - 1)
+    {
+      us /= 2;
+      bucket++;
+    }
+  return bucket;
+}
+
+/* Notes that a read (or, if WRITE, a write) submitted to BLOCK at
+   time START completed at time END. */
+static void
+request_end (struct block *block, int64_t start, int64_t end, bool write)
+{
+  struct block_stats *s = &block->stats;
+  int64_t latency = end > start ? end - start : 0;
+  int bucket = hist_bucket (latency);
+  enum intr_level old_level = intr_disable ();
+
+  s->in_flight--;
+  s->request_cnt++;
+  s->service_us += latency;
+  if (write)
+    s->write_hist[bucket]++;
+  else
+    s->read_hist[bucket]++;
+  intr_set_level (old_level);
+}
+
+/* Adds a transfer of CNT sectors to BLOCK's sector and byte
+   counts. */
+static void
+count_transfer (struct block *block, size_t cnt, bool write)
+{
+  struct block_stats *s = &block->stats;
+  enum intr_level old_level = intr_disable ();
+
+  if (write)
+    {
+      s->write_cnt += cnt;
+      s->write_bytes += (uint64_t) cnt * BLOCK_SECTOR_SIZE;
+    }
+  else
+    {
+      s->read_cnt += cnt;
+      s->read_bytes += (uint64_t) cnt * BLOCK_SECTOR_SIZE;
+    }
+  intr_set_level (old_level);
+}
+
+/* Transfers CNT sectors starting at SECTOR between BLOCK and
+   BUFFER, writing if WRITE is true and reading otherwise, and
+   waits for the transfer to finish.  Goes through the driver's
+   queue if it has one. */
+static void
+transfer (struct block *block, block_sector_t sector, size_t cnt,
+          void *buffer, bool write)
+{
+  int64_t start;
+  size_t i;
+
+  if (block->ops->submit != NULL)
+    {
+      struct block_request req;
+
+      req.write = write;
+      req.sector = sector;
+      req.cnt = cnt;
+      req.buffer = buffer;
+      req.done = NULL;
+      req.aux = NULL;
+      block_submit (block, &req);
+      block_wait (&req);
+      return;
+    }
+
+  check_sector (block, sector);
+  check_sector (block, sector + cnt - 1);
+  ASSERT (!write || block->type != BLOCK_FOREIGN);
+  TRACE (TRACE_BLOCK_START, sector, cnt, write);
+  start = request_begin (block, sector, cnt);
+  if (write && cnt > 1 && block->ops->write_multiple != NULL)
+    block->ops->write_multiple (block->aux, sector, cnt, buffer);
+  else if (!write && cnt > 1 && block->ops->read_multiple != NULL)
+    block->ops->read_multiple (block->aux, sector, cnt, buffer);
+  else
+    for (i = 0; i < cnt; i++)
+      {
+        uint8_t *sector_buf = (uint8_t *) buffer + i * BLOCK_SECTOR_SIZE;
+        if (write)
+          block->ops->write (block->aux, sector + i, sector_buf);
+        else
+          block->ops->read (block->aux, sector + i, sector_buf);
+      }
+  request_end (block, start, timer_usecs (), write);
+  TRACE (TRACE_BLOCK_DONE, sector, cnt, write);
+  count_transfer (block, cnt, write);
+}
+
 /* Reads sector SECTOR from BLOCK into BUFFER, which must
    have room for BLOCK_SECTOR_SIZE bytes.
    Internally synchronizes accesses to block devices, so external
@@ -120,9 +249,7 @@ check_sector (struct block *block, block_sector_t sector)
 void
 block_read (struct block *block, block_sector_t sector, void *buffer)
 {
-  check_sector (block, sector);
-  block->ops->read (block->aux, sector, buffer);
-  block->read_cnt++;
+  transfer (block, sector, 1, buffer, false);
 }
 
 /* Write sector SECTOR to BLOCK from BUFFER, which must contain
@@ -132,11 +259,121 @@ block_read (struct block *block, block_sector_t sector, void *buffer)
    per-block device locking is unneeded. */
 void
 block_write (struct block *block, block_sector_t sector, const void *buffer)
+{
+  transfer (block, sector, 1, (void *) buffer, true);
+}
+
+/* Reads CNT consecutive sectors starting at SECTOR from BLOCK
+   into BUFFER, which must have room for CNT * BLOCK_SECTOR_SIZE
+   bytes.  Drivers that support it move the whole run with as few
+   commands as possible.
+   Internally synchronizes accesses to block devices, so external
+   per-block device locking is unneeded. */
+void
+block_read_multiple (struct block *block, block_sector_t sector,
+                     size_t cnt, void *buffer)
+{
+  if (cnt > 0)
+    transfer (block, sector, cnt, buffer, false);
+}
+
+/* Writes CNT consecutive sectors starting at SECTOR to BLOCK from
+   BUFFER, which must contain CNT * BLOCK_SECTOR_SIZE bytes.
+   Returns after the block device has acknowledged receiving all
+   of the data.
+   Internally synchronizes accesses to block devices, so external
+   per-block device locking is unneeded. */
+void
+block_write_multiple (struct block *block, block_sector_t sector,
+                      size_t cnt, const void *buffer)
+{
+  if (cnt > 0)
+    transfer (block, sector, cnt, (void *) buffer, true);
+}
+
+/* Queues REQ against BLOCK and returns, usually before the
+   transfer has finished.  REQ's write, sector, cnt, buffer, done,
+   and aux members must be set; REQ and its buffer must remain
+   valid until it completes.  See block.h for how completion is
+   reported. */
+void
+block_submit (struct block *block, struct block_request *req)
+{
+  ASSERT (req->cnt > 0);
+
+  check_sector (block, req->sector);
+  check_sector (block, req->sector + req->cnt - 1);
+  req->block = block;
+  req->complete_time = 0;
+  sema_init (&req->done_sema, 0);
+  TRACE (TRACE_BLOCK_START, req->sector, req->cnt, req->write);
+  req->submit_time = request_begin (block, req->sector, req->cnt);
+  block_forward (block, req->sector, req);
+}
+
+/* Waits for REQ, which must have been submitted with a null
+   completion callback, to complete. */
+void
+block_wait (struct block_request *req)
+{
+  ASSERT (req->done == NULL);
+  sema_down (&req->done_sema);
+}
+
+/* Passes REQ on to BLOCK, to start at SECTOR.  Called by
+   block_submit() and by drivers, such as partitions, that are
+   layered on another block device. */
+void
+block_forward (struct block *block, block_sector_t sector,
+               struct block_request *req)
 {
   check_sector (block, sector);
-  ASSERT (block->type != BLOCK_FOREIGN);
-  block->ops->write (block->aux, sector, buffer);
-  block->write_cnt++;
+  check_sector (block, sector + req->cnt - 1);
+  ASSERT (!req->write || block->type != BLOCK_FOREIGN);
+  count_transfer (block, req->cnt, req->write);
+
+  if (block->ops->submit != NULL)
+    block->ops->submit (block->aux, sector, req);
+  else
+    {
+      size_t i;
+
+      for (i = 0; i < req->cnt; i++)
+        {
+          uint8_t *buffer = (uint8_t *) req->buffer + i * BLOCK_SECTOR_SIZE;
+          if (req->write)
+            block->ops->write (block->aux, sector + i, buffer);
+          else
+            block->ops->read (block->aux, sector + i, buffer);
+        }
+      block_request_done (req);
+    }
+}
+
+/* Called by a driver when REQ has completed.  The driver may
+   first set REQ->complete_time to when the hardware finished, per
+   timer_usecs(); otherwise, the current time is used.  Reports
+   completion to the submitter. */
+void
+block_request_done (struct block_request *req)
+{
+  int64_t end = req->complete_time != 0 ? req->complete_time : timer_usecs ();
+
+  request_end (req->block, req->submit_time, end, req->write);
+  TRACE (TRACE_BLOCK_DONE, req->sector, req->cnt, req->write);
+  if (req->done != NULL)
+    req->done (req);
+  else
+    sema_up (&req->done_sema);
+}
+
+/* Copies BLOCK's I/O statistics into *STATS. */
+void
+block_get_stats (struct block *block, struct block_stats *stats)
+{
+  enum intr_level old_level = intr_disable ();
+  *stats = block->stats;
+  intr_set_level (old_level);
 }
 
 /* Returns the number of sectors in BLOCK. */
@@ -160,6 +397,29 @@ block_type (struct block *block)
   return block->type;
 }
 
+/* Prints BLOCK's latency histogram HIST, labeled with KIND, if it
+   has any entries.  Each nonzero bucket is shown as its lower
+   bound in microseconds followed by its count. */
+static void
+print_histogram (struct block *block, const char *kind,
+                 const uint32_t hist[BLOCK_HIST_CNT])
+{
+  bool any = false;
+  int i;
+
+  for (i = 0; i < BLOCK_HIST_CNT; i++)
+    if (hist[i] != 0)
+      {
+        if (!any)
+          printf ("%s (%s): %s latency (us):",
+                  block->name, block_type_name (block->type), kind);
+        any = true;
+        printf (" %d+:%"PRIu32, i == 0 ? 0 : 1 << i, hist[i]);
+      }
+  if (any)
+    printf ("\n");
+}
+
 /* Prints statistics for each block device used for a Pintos role. */
 void
 block_print_stats (void)
@@ -171,9 +431,28 @@ block_print_stats (void)
       struct block *block = block_by_role[i];
       if (block != NULL)
         {
+          struct block_stats s;
+
+          block_get_stats (block, &s);
           printf ("%s (%s): %llu reads, %llu writes\n",
                   block->name, block_type_name (block->type),
-                  block->read_cnt, block->write_cnt);
+                  (unsigned long long) s.read_cnt,
+                  (unsigned long long) s.write_cnt);
+          if (s.request_cnt == 0)
+            continue;
+          printf ("%s (%s): %llu bytes read, %llu bytes written, "
+                  "%llu requests (%llu sequential, %llu random), "
+                  "max in flight %"PRId32", avg service %lld us\n",
+                  block->name, block_type_name (block->type),
+                  (unsigned long long) s.read_bytes,
+                  (unsigned long long) s.write_bytes,
+                  (unsigned long long) s.request_cnt,
+                  (unsigned long long) s.seq_cnt,
+                  (unsigned long long) s.random_cnt,
+                  s.max_in_flight,
+                  (long long) (s.service_us / (int64_t) s.request_cnt));
+          print_histogram (block, "read", s.read_hist);
+          print_histogram (block, "write", s.write_hist);
         }
     }
 }
@@ -198,8 +477,8 @@ block_register (const char *name, enum block_type type,
   block->size = size;
   block->ops = ops;
   block->aux = aux;
-  block->read_cnt = 0;
-  block->write_cnt = 0;
+  memset (&block->stats, 0, sizeof block->stats);
+  block->next_sector = 0;
 
   printf ("%s: %'"PRDSNu" sectors (", block->name, block->size);
   print_human_readable_size ((uint64_t) block->size * BLOCK_SECTOR_SIZE);
@@ -222,5 +501,5 @@ list_elem_to_block (struct list_elem *list_elem)
 }
 
 int get_num_writes(struct block* blk) {
-    return (int) blk->write_cnt;
+    return (int) blk->stats.write_cnt;
 }
@@ -1,8 +1,10 @@
 #ifndef DEVICES_BLOCK_H
 #define DEVICES_BLOCK_H
 
+#include <block-stats.h>
 #include <stddef.h>
 #include <inttypes.h>
+#include "threads/synch.h"
 
 /* Size of a block device sector in bytes.
    All IDE disks use this sector size, as do most USB and SCSI
@@ -56,10 +58,42 @@ struct block *block_next (struct block *);
 block_sector_t block_size (struct block *);
 void block_read (struct block *, block_sector_t, void *);
 void block_write (struct block *, block_sector_t, const void *);
+void block_read_multiple (struct block *, block_sector_t, size_t cnt,
+                          void *);
+void block_write_multiple (struct block *, block_sector_t, size_t cnt,
+                           const void *);
 const char *block_name (struct block *);
 enum block_type block_type (struct block *);
 
+/* Asynchronous requests.
+
+   Submitting a request returns as soon as it is queued.  When
+   the transfer finishes, DONE is called if it is non-null, from
+   a kernel thread belonging to the driver; otherwise the
+   submitter collects the request with block_wait().  Drivers
+   without a queue of their own complete the request before
+   block_submit() returns. */
+struct block_request
+  {
+    bool write;                 /* Write if true, read if false. */
+    block_sector_t sector;      /* First sector. */
+    size_t cnt;                 /* Number of sectors. */
+    void *buffer;               /* CNT * BLOCK_SECTOR_SIZE bytes. */
+    void (*done) (struct block_request *);  /* Callback, or null. */
+    void *aux;                  /* For use by DONE. */
+
+    /* Owned by the block layer until completion. */
+    struct block *block;        /* Device the request was submitted to. */
+    int64_t submit_time;        /* timer_usecs() at submission. */
+    int64_t complete_time;      /* timer_usecs() at completion, or 0. */
+    struct semaphore done_sema; /* Up'd on completion if DONE is null. */
+  };
+
+void block_submit (struct block *, struct block_request *);
+void block_wait (struct block_request *);
+
 /* Statistics. */
+void block_get_stats (struct block *, struct block_stats *);
 void block_print_stats (void);
 
 /* Lower-level interface to block device drivers. */
@@ -68,12 +102,30 @@ struct block_operations
   {
     void (*read) (void *aux, block_sector_t, void *buffer);
     void (*write) (void *aux, block_sector_t, const void *buffer);
+
+    /* Optional.  Move CNT consecutive sectors at once.  If null,
+       the block layer falls back to one read or write per
+       sector. */
+    void (*read_multiple) (void *aux, block_sector_t, size_t cnt,
+                           void *buffer);
+    void (*write_multiple) (void *aux, block_sector_t, size_t cnt,
+                            const void *buffer);
+
+    /* Optional.  Queues REQUEST, to start at the given sector
+       rather than REQUEST->sector, and returns without waiting.
+       The driver must eventually call block_request_done().  If
+       null, the block layer performs the transfer synchronously. */
+    void (*submit) (void *aux, block_sector_t, struct block_request *);
   };
 
 struct block *block_register (const char *name, enum block_type,
                               const char *extra_info, block_sector_t size,
                               const struct block_operations *, void *aux);
 
+void block_forward (struct block *, block_sector_t,
+                    struct block_request *);
+void block_request_done (struct block_request *);
+
 int get_num_writes(struct block* blk);
 
 
@@ -8,10 +8,18 @@
 #include "devices/timer.h"
 #include "threads/io.h"
 #include "threads/interrupt.h"
+#include "threads/malloc.h"
 #include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
 
 /* The code in this file is an interface to an ATA (IDE)
-   controller.  It attempts to comply to [ATA-3]. */
+   controller.  It attempts to comply to [ATA-3].
+
+   Sectors are transferred by bus-master DMA when a PCI IDE
+   controller that supports it (such as the PIIX emulated by
+   QEMU and Bochs) and a DMA-capable disk are found, and by PIO
+   otherwise. */
 
 /* ATA command block port addresses. */
 #define reg_data(CHANNEL) ((CHANNEL)->reg_base + 0)     /* Data. */
@@ -30,10 +38,27 @@
 #define reg_ctl(CHANNEL) ((CHANNEL)->reg_base + 0x206)  /* Control (w/o). */
 #define reg_alt_status(CHANNEL) reg_ctl (CHANNEL)       /* Alt Status (r/o). */
 
+/* Bus master IDE port addresses, relative to the channel's
+   bus master base. */
+#define reg_bm_command(CHANNEL) ((CHANNEL)->bm_base + 0) /* Command. */
+#define reg_bm_status(CHANNEL) ((CHANNEL)->bm_base + 2)  /* Status. */
+#define reg_bm_prdt(CHANNEL) ((CHANNEL)->bm_base + 4)    /* PRD table. */
+
 /* Alternate Status Register bits. */
 #define STA_BSY 0x80            /* Busy. */
 #define STA_DRDY 0x40           /* Device Ready. */
 #define STA_DRQ 0x08            /* Data Request. */
+#define STA_ERR 0x01            /* Error. */
+
+/* Bus Master Command Register bits. */
+#define BM_CMD_START 0x01       /* Start bus master transfer. */
+#define BM_CMD_READ 0x08        /* Direction: 1=write to memory. */
+
+/* Bus Master Status Register bits. */
+#define BM_STA_DRV1 0x40        /* Device 1 DMA capable. */
+#define BM_STA_DRV0 0x20        /* Device 0 DMA capable. */
+#define BM_STA_INTR 0x04        /* Interrupt (write 1 to clear). */
+#define BM_STA_ERR 0x02         /* Error (write 1 to clear). */
 
 /* Control Register bits. */
 #define CTL_SRST 0x04           /* Software Reset. */
@@ -49,6 +74,27 @@
 #define CMD_IDENTIFY_DEVICE 0xec        /* IDENTIFY DEVICE. */
 #define CMD_READ_SECTOR_RETRY 0x20      /* READ SECTOR with retries. */
 #define CMD_WRITE_SECTOR_RETRY 0x30     /* WRITE SECTOR with retries. */
+#define CMD_READ_DMA 0xc8               /* READ DMA with retries. */
+#define CMD_WRITE_DMA 0xca              /* WRITE DMA with retries. */
+
+/* A physical region descriptor, the unit of a bus master's
+   scatter/gather list.  A region may not cross a 64 kB
+   boundary. */
+struct prd
+  {
+    uint32_t addr;              /* Physical address of region. */
+    uint16_t size;              /* Byte count; 0 means 64 kB. */
+    uint16_t flags;             /* PRD_EOT on the last entry. */
+  };
+#define PRD_EOT 0x8000          /* End of table. */
+
+/* Most sectors moved by a single ATA command. */
+#define MAX_XFER_SECTORS 128
+
+/* Entries per PRD table.  A transfer of MAX_XFER_SECTORS sectors
+   (64 kB) crosses at most one 64 kB boundary, so it spans at most
+   two regions. */
+#define PRD_CNT 2
 
 /* An ATA device. */
 struct ata_disk
@@ -57,6 +103,7 @@ struct ata_disk
     struct channel *channel;    /* Channel that disk is attached to. */
     int dev_no;                 /* Device 0 or 1 for master or slave. */
     bool is_ata;                /* Is device an ATA disk? */
+    bool use_dma;               /* Transfer by bus-master DMA? */
   };
 
 /* An ATA channel (aka controller).
@@ -71,6 +118,16 @@ struct channel
     bool expecting_interrupt;   /* True if an interrupt is expected, false if
                                    any interrupt would be spurious. */
     struct semaphore completion_wait;   /* Up'd by interrupt handler. */
+    int64_t intr_time;          /* timer_usecs() at the last interrupt. */
+
+    uint16_t bm_base;           /* Bus master base I/O port, 0 if none. */
+    struct prd *prdt;           /* PRD table, if bm_base is nonzero. */
+
+    struct lock queue_lock;     /* Protects queue, queue_len, head. */
+    struct list queue;          /* Pending ide_requests, oldest first. */
+    size_t queue_len;           /* Number of requests in queue. */
+    struct semaphore queue_cnt; /* Up'd once per queued request. */
+    uint64_t head;              /* Elevator position. */
 
     struct ata_disk devices[2];     /* The devices on this channel. */
   };
@@ -79,16 +136,28 @@ struct channel
 #define CHANNEL_CNT 2
 static struct channel channels[CHANNEL_CNT];
 
+/* PRD tables, one per channel.  The controller requires each
+   table to be 4-byte aligned and not to cross a 64 kB boundary;
+   aligning to the table's own size guarantees both. */
+static struct prd prd_tables[CHANNEL_CNT][PRD_CNT]
+  __attribute__ ((aligned (PRD_CNT * sizeof (struct prd))));
+
 static struct block_operations ide_operations;
 
+static uint16_t find_bus_master (void);
 static void reset_channel (struct channel *);
 static bool check_device_type (struct ata_disk *);
 static void identify_ata_device (struct ata_disk *);
 
-static void select_sector (struct ata_disk *, block_sector_t);
+static void select_sector (struct ata_disk *, block_sector_t, size_t cnt);
 static void issue_pio_command (struct channel *, uint8_t command);
 static void input_sector (struct channel *, void *);
 static void output_sector (struct channel *, const void *);
+static bool dma_transfer (struct ata_disk *, block_sector_t, size_t cnt,
+                          void *, bool to_memory);
+static void transfer (struct ata_disk *, block_sector_t, size_t cnt,
+                      void *, bool write);
+static void channel_thread (void *);
 
 static void wait_until_idle (const struct ata_disk *);
 static bool wait_while_busy (const struct ata_disk *);
@@ -101,6 +170,7 @@ static void interrupt_handler (struct intr_frame *);
 void
 ide_init (void)
 {
+  uint16_t bm_base = find_bus_master ();
   size_t chan_no;
 
   for (chan_no = 0; chan_no < CHANNEL_CNT; chan_no++)
@@ -123,9 +193,17 @@ ide_init (void)
         default:
           NOT_REACHED ();
         }
-      lock_init (&c->lock);
+      lock_init_named (&c->lock, "ide channel lock");
       c->expecting_interrupt = false;
       sema_init (&c->completion_wait, 0);
+      c->intr_time = 0;
+      c->bm_base = bm_base != 0 ? bm_base + chan_no * 8 : 0;
+      c->prdt = prd_tables[chan_no];
+      lock_init_named (&c->queue_lock, "ide queue_lock");
+      list_init (&c->queue);
+      c->queue_len = 0;
+      sema_init (&c->queue_cnt, 0);
+      c->head = 0;
 
       /* Initialize devices. */
       for (dev_no = 0; dev_no < 2; dev_no++)
@@ -136,6 +214,7 @@ ide_init (void)
           d->channel = c;
           d->dev_no = dev_no;
           d->is_ata = false;
+          d->use_dma = false;
         }
 
       /* Register interrupt handler. */
@@ -148,6 +227,11 @@ ide_init (void)
       if (check_device_type (&c->devices[0]))
         check_device_type (&c->devices[1]);
 
+      /* Start the thread that serves the channel's queue.  It is
+         needed by the partition scan that follows identification,
+         and from then on it is the only user of the hardware. */
+      thread_create (c->name, PRI_MAX, channel_thread, c);
+
       /* Read hard disk identity information. */
       for (dev_no = 0; dev_no < 2; dev_no++)
         if (c->devices[dev_no].is_ata)
@@ -159,6 +243,77 @@ ide_init (void)
 
 static char *descramble_ata_string (char *, int size);
 
+/* PCI configuration space port addresses. */
+#define PCI_CONFIG_ADDR 0xcf8
+#define PCI_CONFIG_DATA 0xcfc
+
+/* Reads the 32-bit PCI configuration register at offset REG of
+   function FUNC of device DEV on bus 0. */
+static uint32_t
+pci_read_config (int dev, int func, int reg)
+{
+  outl (PCI_CONFIG_ADDR,
+        0x80000000 | (dev << 11) | (func << 8) | (reg & 0xfc));
+  return inl (PCI_CONFIG_DATA);
+}
+
+/* Writes VALUE to the 32-bit PCI configuration register at
+   offset REG of function FUNC of device DEV on bus 0. */
+static void
+pci_write_config (int dev, int func, int reg, uint32_t value)
+{
+  outl (PCI_CONFIG_ADDR,
+        0x80000000 | (dev << 11) | (func << 8) | (reg & 0xfc));
+  outl (PCI_CONFIG_DATA, value);
+}
+
+/* Looks on PCI bus 0 for an IDE controller that is capable of
+   bus mastering and decodes the legacy channel ports.  If one is
+   found, enables bus mastering on it and returns the base of its
+   bus master registers.  Otherwise, returns 0, and all transfers
+   will use PIO. */
+static uint16_t
+find_bus_master (void)
+{
+  int dev, func;
+
+  for (dev = 0; dev < 32; dev++)
+    for (func = 0; func < 8; func++)
+      {
+        uint32_t id = pci_read_config (dev, func, 0x00);
+        uint32_t class = pci_read_config (dev, func, 0x08);
+        uint32_t bar4, command;
+
+        if ((id & 0xffff) == 0xffff)
+          {
+            /* No function here.  If function 0 is absent then so
+               is the whole device. */
+            if (func == 0)
+              break;
+            continue;
+          }
+
+        /* Class 01h (mass storage), subclass 01h (IDE), with
+           programming interface bit 7 (bus master capable) set
+           and bits 0 and 2 (native-mode channels) clear. */
+        if ((class >> 16) != 0x0101 || !(class & 0x8000)
+            || (class & 0x0500) != 0)
+          continue;
+
+        /* BAR4 must be an I/O space BAR. */
+        bar4 = pci_read_config (dev, func, 0x20);
+        if (!(bar4 & 1) || (bar4 & 0xfffc) == 0)
+          continue;
+
+        /* Enable I/O space decoding and bus mastering. */
+        command = pci_read_config (dev, func, 0x04);
+        pci_write_config (dev, func, 0x04, command | 0x05);
+
+        return bar4 & 0xfffc;
+      }
+  return 0;
+}
+
 /* Resets an ATA channel and waits for any devices present on it
    to finish the reset. */
 static void
@@ -286,8 +441,13 @@ identify_ata_device (struct ata_disk *d)
   capacity = *(uint32_t *) &id[60 * 2];
   model = descramble_ata_string (&id[10 * 2], 20);
   serial = descramble_ata_string (&id[27 * 2], 40);
+  /* Use DMA if the controller has a bus master and word 49 of
+     the identify data says the disk supports DMA. */
+  d->use_dma = (c->bm_base != 0
+                && (*(uint16_t *) &id[49 * 2] & 0x0100) != 0);
   snprintf (extra_info, sizeof extra_info,
-            "model \"%s\", serial \"%s\"", model, serial);
+            "model \"%s\", serial \"%s\"%s", model, serial,
+            d->use_dma ? ", DMA" : "");
 
   /* Disable access to IDE disks over 1 GB, which are likely
      physical IDE disks rather than virtual ones.  If we don't
@@ -337,6 +497,258 @@ descramble_ata_string (char *string, int size)
   return string;
 }
 
+/* Request queueing and elevator scheduling.
+
+   Each channel has a queue of pending requests and a kernel
+   thread that is the only user of the channel's hardware once
+   ide_init() returns.  Callers enqueue a request and either wait
+   for it (ide_read_multiple(), ide_write_multiple()) or return
+   at once and are called back later (ide_submit()).
+
+   The thread picks the next request by C-SCAN: the request with
+   the lowest sector at or past the head position, wrapping to
+   the lowest sector overall.  Requests for the slave disk sort
+   after those for the master.  A request that has waited past
+   its deadline is served first regardless, so that a stream of
+   nearby requests cannot starve a distant one.  Reads get a
+   shorter deadline than writes because someone is usually
+   waiting for them. */
+
+/* Deadlines, in timer ticks after submission. */
+#define READ_DEADLINE (TIMER_FREQ / 2)
+#define WRITE_DEADLINE (TIMER_FREQ * 5)
+
+/* A queued request. */
+struct ide_request
+  {
+    struct list_elem elem;      /* Element in channel's queue. */
+    struct ata_disk *disk;      /* Disk to transfer to or from. */
+    block_sector_t sec_no;      /* First sector. */
+    size_t cnt;                 /* Number of sectors. */
+    void *buffer;               /* CNT * BLOCK_SECTOR_SIZE bytes. */
+    bool write;                 /* Write if true, read if false. */
+    int64_t deadline;           /* Served first once timer reaches this. */
+    struct block_request *breq; /* Request to complete, or null. */
+    struct semaphore done;      /* Up'd on completion if BREQ is null. */
+  };
+
+/* Returns R's position on the elevator's axis. */
+static uint64_t
+request_key (const struct ide_request *r)
+{
+  return ((uint64_t) r->disk->dev_no << 32) | r->sec_no;
+}
+
+/* Initializes R as a request to move CNT sectors starting at
+   SEC_NO of disk D to or from BUFFER. */
+static void
+request_init (struct ide_request *r, struct ata_disk *d,
+              block_sector_t sec_no, size_t cnt, void *buffer, bool write)
+{
+  r->disk = d;
+  r->sec_no = sec_no;
+  r->cnt = cnt;
+  r->buffer = buffer;
+  r->write = write;
+  r->deadline = timer_ticks () + (write ? WRITE_DEADLINE : READ_DEADLINE);
+  r->breq = NULL;
+  sema_init (&r->done, 0);
+}
+
+/* Adds R to its channel's queue and wakes the channel's
+   thread. */
+static void
+request_enqueue (struct ide_request *r)
+{
+  struct channel *c = r->disk->channel;
+
+  lock_acquire (&c->queue_lock);
+  list_push_back (&c->queue, &r->elem);
+  c->queue_len++;
+  lock_release (&c->queue_lock);
+  sema_up (&c->queue_cnt);
+}
+
+/* Removes and returns the next request to serve from channel C's
+   queue, which must not be empty: the request whose deadline
+   passed first, if any has, and otherwise the next one by C-SCAN.
+   Reads and writes have different deadlines, so the request that
+   expired first need not be the oldest one.  C's queue_lock must
+   be held. */
+static struct ide_request *
+elevator_next (struct channel *c)
+{
+  struct ide_request *expired = NULL, *next = NULL, *lowest = NULL;
+  int64_t now = timer_ticks ();
+  struct list_elem *e;
+
+  ASSERT (!list_empty (&c->queue));
+
+  for (e = list_begin (&c->queue); e != list_end (&c->queue);
+       e = list_next (e))
+    {
+      struct ide_request *r = list_entry (e, struct ide_request, elem);
+      uint64_t key = request_key (r);
+
+      if (now >= r->deadline
+          && (expired == NULL || r->deadline < expired->deadline))
+        expired = r;
+      if (lowest == NULL || key < request_key (lowest))
+        lowest = r;
+      if (key >= c->head && (next == NULL || key < request_key (next)))
+        next = r;
+    }
+  if (expired != NULL)
+    next = expired;
+  if (next == NULL)
+    next = lowest;
+
+  list_remove (&next->elem);
+  c->queue_len--;
+  c->head = request_key (next) + next->cnt;
+  return next;
+}
+
+/* Serves channel C_'s queue forever. */
+static void
+channel_thread (void *c_)
+{
+  struct channel *c = c_;
+
+  for (;;)
+    {
+      struct ide_request *r;
+
+      sema_down (&c->queue_cnt);
+      lock_acquire (&c->queue_lock);
+      r = elevator_next (c);
+      lock_release (&c->queue_lock);
+
+      lock_acquire (&c->lock);
+      transfer (r->disk, r->sec_no, r->cnt, r->buffer, r->write);
+      lock_release (&c->lock);
+
+      if (r->breq != NULL)
+        {
+          /* The transfer's last interrupt marks its completion. */
+          struct block_request *breq = r->breq;
+          breq->complete_time = c->intr_time;
+          free (r);
+          block_request_done (breq);
+        }
+      else
+        sema_up (&r->done);
+    }
+}
+
+/* Moves CNT sectors starting at SEC_NO of disk D to or from
+   BUFFER, by DMA if possible and by PIO otherwise.  Each run of
+   up to MAX_XFER_SECTORS sectors takes one ATA command.  D's
+   channel lock must be held. */
+static void
+transfer (struct ata_disk *d, block_sector_t sec_no, size_t cnt,
+          void *buffer_, bool write)
+{
+  struct channel *c = d->channel;
+  uint8_t *buffer = buffer_;
+
+  ASSERT (lock_held_by_current_thread (&c->lock));
+
+  while (cnt > 0)
+    {
+      size_t xfer_cnt = cnt < MAX_XFER_SECTORS ? cnt : MAX_XFER_SECTORS;
+      size_t i;
+
+      if (!d->use_dma || !dma_transfer (d, sec_no, xfer_cnt, buffer, !write))
+        {
+          select_sector (d, sec_no, xfer_cnt);
+          if (!write)
+            {
+              issue_pio_command (c, CMD_READ_SECTOR_RETRY);
+              for (i = 0; i < xfer_cnt; i++)
+                {
+                  sema_down (&c->completion_wait);
+                  if (!wait_while_busy (d))
+                    PANIC ("%s: disk read failed, sector=%"PRDSNu,
+                           d->name, sec_no + i);
+                  input_sector (c, buffer + i * BLOCK_SECTOR_SIZE);
+                }
+            }
+          else
+            {
+              issue_pio_command (c, CMD_WRITE_SECTOR_RETRY);
+              for (i = 0; i < xfer_cnt; i++)
+                {
+                  if (!wait_while_busy (d))
+                    PANIC ("%s: disk write failed, sector=%"PRDSNu,
+                           d->name, sec_no + i);
+                  output_sector (c, buffer + i * BLOCK_SECTOR_SIZE);
+                  sema_down (&c->completion_wait);
+                }
+            }
+        }
+
+      sec_no += xfer_cnt;
+      buffer += xfer_cnt * BLOCK_SECTOR_SIZE;
+      cnt -= xfer_cnt;
+    }
+}
+
+/* Reads CNT sectors starting at SEC_NO from disk D into BUFFER,
+   which must have room for CNT * BLOCK_SECTOR_SIZE bytes.
+   Internally synchronizes accesses to disks, so external
+   per-disk locking is unneeded. */
+static void
+ide_read_multiple (void *d_, block_sector_t sec_no, size_t cnt,
+                   void *buffer)
+{
+  struct ide_request r;
+
+  request_init (&r, d_, sec_no, cnt, buffer, false);
+  request_enqueue (&r);
+  sema_down (&r.done);
+}
+
+/* Writes CNT sectors starting at SEC_NO to disk D from BUFFER,
+   which must contain CNT * BLOCK_SECTOR_SIZE bytes.  Returns
+   after the disk has acknowledged receiving the data.
+   Internally synchronizes accesses to disks, so external
+   per-disk locking is unneeded. */
+static void
+ide_write_multiple (void *d_, block_sector_t sec_no, size_t cnt,
+                    const void *buffer)
+{
+  struct ide_request r;
+
+  request_init (&r, d_, sec_no, cnt, (void *) buffer, true);
+  request_enqueue (&r);
+  sema_down (&r.done);
+}
+
+/* Queues block layer request BREQ against disk D, starting at
+   SEC_NO, and returns without waiting for it.  BREQ is completed
+   from D's channel thread. */
+static void
+ide_submit (void *d_, block_sector_t sec_no, struct block_request *breq)
+{
+  struct ide_request *r = malloc (sizeof *r);
+
+  if (r == NULL)
+    {
+      /* Out of memory: wait for the transfer instead. */
+      struct ide_request local;
+      request_init (&local, d_, sec_no, breq->cnt, breq->buffer,
+                    breq->write);
+      request_enqueue (&local);
+      sema_down (&local.done);
+      block_request_done (breq);
+      return;
+    }
+  request_init (r, d_, sec_no, breq->cnt, breq->buffer, breq->write);
+  r->breq = breq;
+  request_enqueue (r);
+}
+
 /* Reads sector SEC_NO from disk D into BUFFER, which must have
    room for BLOCK_SECTOR_SIZE bytes.
    Internally synchronizes accesses to disks, so external
@@ -344,16 +756,7 @@ descramble_ata_string (char *string, int size)
 static void
 ide_read (void *d_, block_sector_t sec_no, void *buffer)
 {
-  struct ata_disk *d = d_;
-  struct channel *c = d->channel;
-  lock_acquire (&c->lock);
-  select_sector (d, sec_no);
-  issue_pio_command (c, CMD_READ_SECTOR_RETRY);
-  sema_down (&c->completion_wait);
-  if (!wait_while_busy (d))
-    PANIC ("%s: disk read failed, sector=%"PRDSNu, d->name, sec_no);
-  input_sector (c, buffer);
-  lock_release (&c->lock);
+  ide_read_multiple (d_, sec_no, 1, buffer);
 }
 
 /* Write sector SEC_NO to disk D from BUFFER, which must contain
@@ -364,36 +767,31 @@ ide_read (void *d_, block_sector_t sec_no, void *buffer)
 static void
 ide_write (void *d_, block_sector_t sec_no, const void *buffer)
 {
-  struct ata_disk *d = d_;
-  struct channel *c = d->channel;
-  lock_acquire (&c->lock);
-  select_sector (d, sec_no);
-  issue_pio_command (c, CMD_WRITE_SECTOR_RETRY);
-  if (!wait_while_busy (d))
-    PANIC ("%s: disk write failed, sector=%"PRDSNu, d->name, sec_no);
-  output_sector (c, buffer);
-  sema_down (&c->completion_wait);
-  lock_release (&c->lock);
+  ide_write_multiple (d_, sec_no, 1, buffer);
 }
 
 static struct block_operations ide_operations =
   {
     ide_read,
-    ide_write
+    ide_write,
+    ide_read_multiple,
+    ide_write_multiple,
+    ide_submit
   };
 
 /* Selects device D, waiting for it to become ready, and then
-   writes SEC_NO to the disk's sector selection registers.  (We
-   use LBA mode.) */
+   writes SEC_NO to the disk's sector selection registers and CNT
+   to its sector count register.  (We use LBA mode.) */
 static void
-select_sector (struct ata_disk *d, block_sector_t sec_no)
+select_sector (struct ata_disk *d, block_sector_t sec_no, size_t cnt)
 {
   struct channel *c = d->channel;
 
   ASSERT (sec_no < (1UL << 28));
+  ASSERT (cnt > 0 && cnt <= MAX_XFER_SECTORS);
 
   select_device_wait (d);
-  outb (reg_nsect (c), 1);
+  outb (reg_nsect (c), cnt);
   outb (reg_lbal (c), sec_no);
   outb (reg_lbam (c), sec_no >> 8);
   outb (reg_lbah (c), (sec_no >> 16));
@@ -430,6 +828,86 @@ output_sector (struct channel *c, const void *sector)
   outsw (reg_data (c), sector, BLOCK_SECTOR_SIZE / 2);
 }
 
+/* Transfers CNT sectors starting at SEC_NO of disk D to or from
+   BUFFER by bus-master DMA: into BUFFER if TO_MEMORY is true, out
+   of it otherwise.  The CPU only programs the transfer and then sleeps
+   until the completion interrupt.  D's channel lock must be held.
+
+   Returns true if successful.  Returns false without touching
+   the disk if BUFFER cannot be a DMA target, and returns false
+   after turning off DMA for D if the controller or the disk
+   reports an error; either way the caller should retry with
+   PIO. */
+static bool
+dma_transfer (struct ata_disk *d, block_sector_t sec_no, size_t cnt,
+              void *buffer, bool to_memory)
+{
+  struct channel *c = d->channel;
+  struct prd *prd = c->prdt;
+  uintptr_t addr, end;
+  uint8_t bm_status, status;
+
+  ASSERT (lock_held_by_current_thread (&c->lock));
+
+  /* The controller needs the physical address of an even-aligned
+     buffer.  Kernel virtual memory maps physical memory
+     one-to-one, so the buffer is physically contiguous. */
+  if (!is_kernel_vaddr (buffer) || ((uintptr_t) buffer & 1) != 0)
+    return false;
+
+  /* Build the PRD table, starting a new region at each 64 kB
+     boundary the buffer crosses. */
+  addr = vtop (buffer);
+  end = addr + cnt * BLOCK_SECTOR_SIZE;
+  for (;;)
+    {
+      uintptr_t boundary = (addr | 0xffff) + 1;
+      uintptr_t region_end = end < boundary ? end : boundary;
+
+      ASSERT (prd < c->prdt + PRD_CNT);
+      prd->addr = addr;
+      prd->size = region_end - addr;    /* 64 kB wraps to 0, as wanted. */
+      prd->flags = 0;
+      addr = region_end;
+      if (addr == end)
+        break;
+      prd++;
+    }
+  prd->flags = PRD_EOT;
+
+  /* Stop any previous transfer, set the direction, point the
+     controller at the table, and clear stale error and interrupt
+     bits. */
+  outb (reg_bm_command (c), to_memory ? BM_CMD_READ : 0);
+  outl (reg_bm_prdt (c), vtop (c->prdt));
+  outb (reg_bm_status (c),
+        (inb (reg_bm_status (c)) & (BM_STA_DRV0 | BM_STA_DRV1))
+        | BM_STA_INTR | BM_STA_ERR);
+
+  /* Issue the command to the disk, then start the bus master. */
+  select_sector (d, sec_no, cnt);
+  issue_pio_command (c, to_memory ? CMD_READ_DMA : CMD_WRITE_DMA);
+  outb (reg_bm_command (c), (to_memory ? BM_CMD_READ : 0) | BM_CMD_START);
+  sema_down (&c->completion_wait);
+
+  /* Stop the bus master and collect the outcome. */
+  outb (reg_bm_command (c), to_memory ? BM_CMD_READ : 0);
+  bm_status = inb (reg_bm_status (c));
+  status = inb (reg_alt_status (c));
+  outb (reg_bm_status (c),
+        (bm_status & (BM_STA_DRV0 | BM_STA_DRV1))
+        | BM_STA_INTR | BM_STA_ERR);
+
+  if ((bm_status & BM_STA_ERR) != 0 || (status & STA_ERR) != 0)
+    {
+      printf ("%s: DMA %s failed, sector=%"PRDSNu", falling back to PIO\n",
+              d->name, to_memory ? "read" : "write", sec_no);
+      d->use_dma = false;
+      return false;
+    }
+  return true;
+}
+
 /* Low-level ATA primitives. */
 
 /* Wait up to 10 seconds for the controller to become idle, that
@@ -514,6 +992,7 @@ interrupt_handler (struct intr_frame *f)
         if (c->expecting_interrupt)
           {
             inb (reg_status (c));               /* Acknowledge interrupt. */
+            c->intr_time = timer_usecs ();      /* Note completion time. */
             sema_up (&c->completion_wait);      /* Wake up waiter. */
           }
         else
@@ -4,6 +4,7 @@
 #include <string.h>
 #include <stdio.h>
 #include "devices/block.h"
+#include "threads/interrupt.h"
 #include "threads/malloc.h"
 
 /* A partition of a block device. */
@@ -317,8 +318,241 @@ partition_write (void *p_, block_sector_t sector, const void *buffer)
   block_write (p->block, p->start + sector, buffer);
 }
 
+/* Reads CNT sectors starting at SECTOR from partition P into
+   BUFFER, which must have room for CNT * BLOCK_SECTOR_SIZE
+   bytes. */
+static void
+partition_read_multiple (void *p_, block_sector_t sector, size_t cnt,
+                         void *buffer)
+{
+  struct partition *p = p_;
+  block_read_multiple (p->block, p->start + sector, cnt, buffer);
+}
+
+/* Writes CNT sectors starting at SECTOR to partition P from
+   BUFFER, which must contain CNT * BLOCK_SECTOR_SIZE bytes. */
+static void
+partition_write_multiple (void *p_, block_sector_t sector, size_t cnt,
+                          const void *buffer)
+{
+  struct partition *p = p_;
+  block_write_multiple (p->block, p->start + sector, cnt, buffer);
+}
+
+/* Queues REQ against partition P, starting at SECTOR. */
+static void
+partition_submit (void *p_, block_sector_t sector,
+                  struct block_request *req)
+{
+  struct partition *p = p_;
+  block_forward (p->block, p->start + sector, req);
+}
+
 static struct block_operations partition_operations =
   {
     partition_read,
-    partition_write
+    partition_write,
+    partition_read_multiple,
+    partition_write_multiple,
+    partition_submit
+  };
+
+/* Striped block devices.
+
+   A striped device spreads its sectors across several member
+   devices, usually partitions on disks attached to different IDE
+   channels, CHUNK sectors at a time: chunk 0 is on member 0,
+   chunk 1 on member 1, and so on round-robin.  A request that
+   spans chunks on several members is split and submitted to all
+   of them at once, so that the channels transfer concurrently.
+   The file system's buffer cache reads and writes one sector at
+   a time, so it gets the same effect when it flushes, by keeping
+   several writes in flight (see cache_write_batch()). */
+
+/* Most members in a striped device. */
+#define STRIPE_MAX_MEMBERS 4
+
+/* A striped device. */
+struct stripe
+  {
+    struct block *members[STRIPE_MAX_MEMBERS];  /* Member devices. */
+    size_t member_cnt;                  /* Number of members. */
+    block_sector_t chunk;               /* Sectors per chunk. */
+  };
+
+/* An in-progress request against a striped device. */
+struct stripe_request
+  {
+    struct block_request *parent;       /* Request being served. */
+    size_t pending;                     /* Pieces not yet completed. */
+    struct block_request pieces[];      /* One per chunk touched. */
+  };
+
+static struct block_operations stripe_operations;
+
+/* Creates a striped device named NAME over the comma-separated
+   list of block device names in MEMBER_NAMES, with CHUNK sectors
+   per chunk, and registers it as a raw block device.  Its size is
+   the largest multiple of CHUNK that every member can hold, times
+   the number of members.  Give it a role with, e.g.,
+   -filesys=NAME. */
+void
+partition_stripe (const char *name, char *member_names,
+                  block_sector_t chunk)
+{
+  struct stripe *s;
+  block_sector_t member_size = (block_sector_t) -1;
+  char *member_name, *save_ptr;
+  char extra_info[128];
+  size_t i;
+
+  if (chunk == 0)
+    PANIC ("%s: stripe chunk size must be positive", name);
+
+  s = malloc (sizeof *s);
+  if (s == NULL)
+    PANIC ("Failed to allocate memory for stripe descriptor");
+  s->member_cnt = 0;
+  s->chunk = chunk;
+
+  for (member_name = strtok_r (member_names, ",", &save_ptr);
+       member_name != NULL;
+       member_name = strtok_r (NULL, ",", &save_ptr))
+    {
+      struct block *member = block_get_by_name (member_name);
+      if (member == NULL)
+        PANIC ("%s: no such block device \"%s\"", name, member_name);
+      if (s->member_cnt >= STRIPE_MAX_MEMBERS)
+        PANIC ("%s: at most %d members allowed", name, STRIPE_MAX_MEMBERS);
+      for (i = 0; i < s->member_cnt; i++)
+        if (s->members[i] == member)
+          PANIC ("%s: \"%s\" listed twice", name, member_name);
+      s->members[s->member_cnt++] = member;
+      if (block_size (member) < member_size)
+        member_size = block_size (member);
+    }
+  if (s->member_cnt < 2)
+    PANIC ("%s: a stripe needs at least two members", name);
+
+  snprintf (extra_info, sizeof extra_info,
+            "striped across %zu devices, %"PRDSNu"-sector chunks",
+            s->member_cnt, chunk);
+  block_register (name, BLOCK_RAW, extra_info,
+                  member_size / chunk * chunk * s->member_cnt,
+                  &stripe_operations, s);
+}
+
+/* Maps SECTOR of striped device S to a member, returned, and a
+   sector within that member, stored in *MEMBER_SECTOR. */
+static struct block *
+stripe_map (const struct stripe *s, block_sector_t sector,
+            block_sector_t *member_sector)
+{
+  block_sector_t chunk_no = sector / s->chunk;
+
+  *member_sector = chunk_no / s->member_cnt * s->chunk + sector % s->chunk;
+  return s->members[chunk_no % s->member_cnt];
+}
+
+/* Reads sector SECTOR from striped device S into BUFFER, which
+   must have room for BLOCK_SECTOR_SIZE bytes. */
+static void
+stripe_read (void *s_, block_sector_t sector, void *buffer)
+{
+  block_sector_t member_sector;
+  struct block *member = stripe_map (s_, sector, &member_sector);
+  block_read (member, member_sector, buffer);
+}
+
+/* Writes sector SECTOR to striped device S from BUFFER, which
+   must contain BLOCK_SECTOR_SIZE bytes. */
+static void
+stripe_write (void *s_, block_sector_t sector, const void *buffer)
+{
+  block_sector_t member_sector;
+  struct block *member = stripe_map (s_, sector, &member_sector);
+  block_write (member, member_sector, buffer);
+}
+
+/* Completion callback for one piece of a striped request.
+   Completes the whole request once its last piece is done. */
+static void
+stripe_piece_done (struct block_request *piece)
+{
+  struct stripe_request *sr = piece->aux;
+  enum intr_level old_level;
+  bool last;
+
+  old_level = intr_disable ();
+  last = --sr->pending == 0;
+  intr_set_level (old_level);
+
+  if (last)
+    {
+      struct block_request *parent = sr->parent;
+      free (sr);
+      block_request_done (parent);
+    }
+}
+
+/* Queues REQ against striped device S, starting at SECTOR, as
+   one request per chunk it touches, all in flight at once. */
+static void
+stripe_submit (void *s_, block_sector_t sector, struct block_request *req)
+{
+  struct stripe *s = s_;
+  block_sector_t first_chunk = sector / s->chunk;
+  block_sector_t last_chunk = (sector + req->cnt - 1) / s->chunk;
+  size_t piece_cnt = last_chunk - first_chunk + 1;
+  struct stripe_request *sr;
+  uint8_t *buffer = req->buffer;
+  size_t left = req->cnt;
+  size_t i;
+
+  sr = malloc (sizeof *sr + piece_cnt * sizeof *sr->pieces);
+  if (sr == NULL)
+    {
+      /* Out of memory: do the pieces one at a time. */
+      for (; left > 0; sector++, left--, buffer += BLOCK_SECTOR_SIZE)
+        if (req->write)
+          stripe_write (s, sector, buffer);
+        else
+          stripe_read (s, sector, buffer);
+      block_request_done (req);
+      return;
+    }
+  /* Count every piece as pending before submitting any, since a
+     member without a queue completes its piece at once. */
+  sr->parent = req;
+  sr->pending = piece_cnt;
+
+  for (i = 0; i < piece_cnt; i++)
+    {
+      struct block_request *piece = &sr->pieces[i];
+      block_sector_t member_sector;
+      struct block *member = stripe_map (s, sector, &member_sector);
+      size_t chunk_left = s->chunk - sector % s->chunk;
+      size_t cnt = left < chunk_left ? left : chunk_left;
+
+      piece->write = req->write;
+      piece->sector = member_sector;
+      piece->cnt = cnt;
+      piece->buffer = buffer;
+      piece->done = stripe_piece_done;
+      piece->aux = sr;
+      block_submit (member, piece);
+
+      sector += cnt;
+      buffer += cnt * BLOCK_SECTOR_SIZE;
+      left -= cnt;
+    }
+}
+
+static struct block_operations stripe_operations =
+  {
+    stripe_read,
+    stripe_write,
+    NULL,
+    NULL,
+    stripe_submit
   };
@@ -1,8 +1,10 @@
 #ifndef DEVICES_PARTITION_H
 #define DEVICES_PARTITION_H
 
-struct block;
+#include "devices/block.h"
 
 void partition_scan (struct block *);
+void partition_stripe (const char *name, char *member_names,
+                       block_sector_t chunk);
 
 #endif /* devices/partition.h */
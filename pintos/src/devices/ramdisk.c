@@ -0,0 +1,168 @@
+#include "devices/ramdisk.h"
+#include <debug.h>
+#include <round.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/block.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+/* A block device whose sectors live in kernel memory.  Transfers
+   are plain memory copies, so a file system on a RAM disk shows
+   the CPU cost of the file system code with no device latency.
+
+   RAM disks are requested on the kernel command line with
+   -ramdisk=SIZE, once per disk, and registered as "rd0", "rd1",
+   and so on, of type BLOCK_RAW.  Assign one a role with, e.g.,
+   -filesys=rd0.  Their contents do not survive a reboot, so a
+   RAM disk used as the file system device must be formatted
+   with -f. */
+
+/* Sectors per page of backing memory. */
+#define SECTORS_PER_PAGE (PGSIZE / BLOCK_SECTOR_SIZE)
+
+/* Most RAM disks that may be requested. */
+#define RAMDISK_CNT 4
+
+/* A RAM disk. */
+struct ramdisk
+  {
+    char name[8];               /* Name, e.g. "rd0". */
+    size_t page_cnt;            /* Number of pages of backing memory. */
+    uint8_t **pages;            /* Backing memory, one page at a time. */
+  };
+
+/* Sizes, in kB, of requested RAM disks. */
+static size_t requested_kb[RAMDISK_CNT];
+static size_t requested_cnt;
+
+static struct block_operations ramdisk_operations;
+
+/* Requests a RAM disk of KB kB, rounded up to a whole number of
+   pages.  Called while the kernel command line is parsed, before
+   memory allocation is available; the disk is created by
+   ramdisk_init(). */
+void
+ramdisk_configure (size_t kb)
+{
+  if (kb == 0)
+    PANIC ("RAM disk size must be positive");
+  if (requested_cnt >= RAMDISK_CNT)
+    PANIC ("at most %d RAM disks may be requested", RAMDISK_CNT);
+  requested_kb[requested_cnt++] = kb;
+}
+
+/* Creates and registers the RAM disks requested with
+   ramdisk_configure(). */
+void
+ramdisk_init (void)
+{
+  size_t i, j;
+
+  for (i = 0; i < requested_cnt; i++)
+    {
+      struct ramdisk *rd = malloc (sizeof *rd);
+
+      if (rd == NULL)
+        PANIC ("couldn't allocate RAM disk descriptor");
+      snprintf (rd->name, sizeof rd->name, "rd%zu", i);
+      rd->page_cnt = DIV_ROUND_UP (requested_kb[i] * 1024, PGSIZE);
+      rd->pages = malloc (rd->page_cnt * sizeof *rd->pages);
+      if (rd->pages == NULL)
+        PANIC ("%s: couldn't allocate page table", rd->name);
+
+      /* The pages need not be contiguous, so allocate them one at
+         a time, which only fails if memory is really short. */
+      for (j = 0; j < rd->page_cnt; j++)
+        {
+          rd->pages[j] = palloc_get_page (PAL_ZERO);
+          if (rd->pages[j] == NULL)
+            PANIC ("%s: out of memory after %zu of %zu pages",
+                   rd->name, j, rd->page_cnt);
+        }
+
+      block_register (rd->name, BLOCK_RAW, "RAM disk",
+                      rd->page_cnt * SECTORS_PER_PAGE,
+                      &ramdisk_operations, rd);
+    }
+}
+
+/* Returns the address of sector SECTOR of RD. */
+static uint8_t *
+sector_addr (struct ramdisk *rd, block_sector_t sector)
+{
+  ASSERT (sector / SECTORS_PER_PAGE < rd->page_cnt);
+  return (rd->pages[sector / SECTORS_PER_PAGE]
+          + sector % SECTORS_PER_PAGE * BLOCK_SECTOR_SIZE);
+}
+
+/* Reads CNT sectors starting at SECTOR from RAM disk RD_ into
+   BUFFER, which must have room for CNT * BLOCK_SECTOR_SIZE
+   bytes. */
+static void
+ramdisk_read_multiple (void *rd_, block_sector_t sector, size_t cnt,
+                       void *buffer_)
+{
+  struct ramdisk *rd = rd_;
+  uint8_t *buffer = buffer_;
+
+  while (cnt > 0)
+    {
+      /* Copy up to the end of the current page. */
+      size_t chunk = SECTORS_PER_PAGE - sector % SECTORS_PER_PAGE;
+      if (chunk > cnt)
+        chunk = cnt;
+      memcpy (buffer, sector_addr (rd, sector), chunk * BLOCK_SECTOR_SIZE);
+      sector += chunk;
+      buffer += chunk * BLOCK_SECTOR_SIZE;
+      cnt -= chunk;
+    }
+}
+
+/* Writes CNT sectors starting at SECTOR to RAM disk RD_ from
+   BUFFER, which must contain CNT * BLOCK_SECTOR_SIZE bytes. */
+static void
+ramdisk_write_multiple (void *rd_, block_sector_t sector, size_t cnt,
+                        const void *buffer_)
+{
+  struct ramdisk *rd = rd_;
+  const uint8_t *buffer = buffer_;
+
+  while (cnt > 0)
+    {
+      /* Copy up to the end of the current page. */
+      size_t chunk = SECTORS_PER_PAGE - sector % SECTORS_PER_PAGE;
+      if (chunk > cnt)
+        chunk = cnt;
+      memcpy (sector_addr (rd, sector), buffer, chunk * BLOCK_SECTOR_SIZE);
+      sector += chunk;
+      buffer += chunk * BLOCK_SECTOR_SIZE;
+      cnt -= chunk;
+    }
+}
+
+/* Reads sector SECTOR from RAM disk RD into BUFFER, which must
+   have room for BLOCK_SECTOR_SIZE bytes. */
+static void
+ramdisk_read (void *rd, block_sector_t sector, void *buffer)
+{
+  ramdisk_read_multiple (rd, sector, 1, buffer);
+}
+
+/* Writes sector SECTOR to RAM disk RD from BUFFER, which must
+   contain BLOCK_SECTOR_SIZE bytes. */
+static void
+ramdisk_write (void *rd, block_sector_t sector, const void *buffer)
+{
+  ramdisk_write_multiple (rd, sector, 1, buffer);
+}
+
+static struct block_operations ramdisk_operations =
+  {
+    ramdisk_read,
+    ramdisk_write,
+    ramdisk_read_multiple,
+    ramdisk_write_multiple,
+    NULL
+  };
@@ -5,6 +5,7 @@
 #include <stdio.h>
 #include "devices/pit.h"
 #include "threads/interrupt.h"
+#include "threads/profile.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
 
@@ -24,6 +25,10 @@ static int64_t ticks;
    Initialized by timer_calibrate(). */
 static unsigned loops_per_tick;
 
+/* Timer interrupts since the last tick, when the profiler makes
+   them come PROFILE_RATE times per tick. */
+static unsigned profile_subticks;
+
 static intr_handler_func timer_interrupt;
 static bool too_many_loops (unsigned loops);
 static void busy_wait (int64_t loops);
@@ -35,7 +40,8 @@ static void real_time_delay (int64_t num, int32_t denom);
 void
 timer_init (void)
 {
-  pit_configure_channel (0, 2, TIMER_FREQ);
+  pit_configure_channel (0, 2, profile_enabled ? TIMER_FREQ * PROFILE_RATE
+                                                : TIMER_FREQ);
   intr_register_ext (0x20, timer_interrupt, "8254 Timer");
 }
 
@@ -84,6 +90,32 @@ timer_elapsed (int64_t then)
   return timer_ticks () - then;
 }
 
+/* Returns the number of microseconds since the OS booted, with
+   the resolution of the PIT's counter rather than of a timer
+   tick.  If a timer interrupt is pending but not yet handled,
+   the result lags by up to one tick. */
+int64_t
+timer_usecs (void)
+{
+  /* Counter reload value, as computed by pit_configure_channel(). */
+  const int freq = profile_enabled ? TIMER_FREQ * PROFILE_RATE : TIMER_FREQ;
+  const int period = (PIT_HZ + freq / 2) / freq;
+  enum intr_level old_level;
+  int64_t t;
+  unsigned subticks;
+  int count;
+
+  old_level = intr_disable ();
+  t = ticks;
+  subticks = profile_subticks;
+  count = pit_read_count (0);
+  intr_set_level (old_level);
+
+  return (t * (1000000 / TIMER_FREQ)
+          + (int64_t) subticks * 1000000 / freq
+          + (int64_t) (period - count) * 1000000 / PIT_HZ);
+}
+
 /* Sleeps for approximately TICKS timer ticks.  Interrupts must
    be turned on. */
 void
@@ -168,8 +200,15 @@ timer_print_stats (void)
 
 /* Timer interrupt handler. */
 static void
-timer_interrupt (struct intr_frame *args UNUSED)
+timer_interrupt (struct intr_frame *f)
 {
+  if (profile_enabled)
+    {
+      profile_sample (f);
+      if (++profile_subticks < PROFILE_RATE)
+        return;
+      profile_subticks = 0;
+    }
   ticks++;
   thread_tick ();
 }
@@ -5,6 +5,7 @@
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
 #include "threads/malloc.h"
+#include "threads/slab.h"
 #include "threads/thread.h"
 
 /* A directory. */
@@ -14,6 +15,16 @@ struct dir
     off_t pos;                          /* Current position. */
   };
 
+/* Cache of struct dir. */
+static struct kmem_cache dir_cache;
+
+/* Initializes the directory module. */
+void
+dir_init (void)
+{
+  kmem_cache_init (&dir_cache, "dir", sizeof (struct dir), NULL);
+}
+
 /* A single directory entry. */
 struct dir_entry
   {
@@ -39,7 +50,7 @@ dir_open (struct inode *inode)
         inode_close(inode);
         return NULL;
     }
-  struct dir *dir = calloc (1, sizeof *dir);
+  struct dir *dir = kmem_cache_alloc (&dir_cache);
   if (inode != NULL && dir != NULL)
     {
       dir->inode = inode;
@@ -49,7 +60,7 @@ dir_open (struct inode *inode)
   else
     {
       inode_close (inode);
-      free (dir);
+      kmem_cache_free (&dir_cache, dir);
       return NULL;
     }
 }
@@ -77,7 +88,7 @@ dir_close (struct dir *dir)
   if (dir != NULL)
     {
       inode_close (dir->inode);
-      free (dir);
+      kmem_cache_free (&dir_cache, dir);
     }
 }
 
@@ -92,7 +103,8 @@ dir_get_inode (struct dir *dir)
    If successful, returns true, sets *EP to the directory entry
    if EP is non-null, and sets *OFSP to the byte offset of the
    directory entry if OFSP is non-null.
-   otherwise, returns false and ignores EP and OFSP. */
+   otherwise, returns false and ignores EP and OFSP.
+   The caller must hold DIR's directory lock. */
 static bool
 lookup (const struct dir *dir, const char *name,
         struct dir_entry *ep, off_t *ofsp)
@@ -129,10 +141,14 @@ dir_lookup (const struct dir *dir, const char *name,
   ASSERT (dir != NULL);
   ASSERT (name != NULL);
 
+  /* Open the inode before dropping the lock, so that a concurrent
+     dir_remove() cannot free it in between. */
+  inode_lock_dir (dir->inode);
   if (lookup (dir, name, &e, NULL))
     *inode = inode_open (e.inode_sector);
   else
     *inode = NULL;
+  inode_unlock_dir (dir->inode);
 
   return *inode != NULL;
 }
@@ -157,6 +173,8 @@ dir_add (struct dir *dir, const char *name, block_sector_t inode_sector)
   if (*name == '\0' || strlen (name) > NAME_MAX)
     return false;
 
+  inode_lock_dir (dir->inode);
+
   /* Check that NAME is not in use. */
   if (lookup (dir, name, NULL, NULL))
     goto done;
@@ -180,12 +198,16 @@ dir_add (struct dir *dir, const char *name, block_sector_t inode_sector)
   success = inode_write_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
 
  done:
+  inode_unlock_dir (dir->inode);
   return success;
 }
 
 /* Removes any entry for NAME in DIR.
    Returns true if successful, false on failure,
-   which occurs only if there is no file with the given NAME. */
+   which occurs only if there is no file with the given NAME.
+   DIR's lock is held throughout, so the emptiness and open-count
+   checks on a subdirectory cannot race with an add into it made
+   by way of this directory. */
 bool
 dir_remove (struct dir *dir, const char *name)
 {
@@ -197,6 +219,13 @@ dir_remove (struct dir *dir, const char *name)
   ASSERT (dir != NULL);
   ASSERT (name != NULL);
 
+  /* "." and ".." are never removable, and locking them here would
+     take DIR's lock twice or a parent after its child. */
+  if (!strcmp (name, ".") || !strcmp (name, ".."))
+    return false;
+
+  inode_lock_dir (dir->inode);
+
   /* Find directory entry. */
   if (!lookup (dir, name, &e, &ofs))
     goto done;
@@ -221,6 +250,7 @@ dir_remove (struct dir *dir, const char *name)
             e.in_use = false;
             if (inode_write_at (dir->inode, &e, sizeof e, ofs) != sizeof e)
             {
+              inode_unlock_dir (dir->inode);
               dir_close(inode_dir);
               return success;
             }
@@ -229,16 +259,19 @@ dir_remove (struct dir *dir, const char *name)
             inode_remove (inode);
             success = true;
 
+            inode_unlock_dir (dir->inode);
             dir_close(inode_dir);
             return success;
        }
        else {
+           inode_unlock_dir (dir->inode);
            dir_close(inode_dir);
            return success;
        }
   }
 
  done:
+  inode_unlock_dir (dir->inode);
   inode_close (inode);
   return success;
 }
@@ -250,17 +283,21 @@ bool
 dir_readdir (struct dir *dir, char name[NAME_MAX + 1])
 {
   struct dir_entry e;
+  bool found = false;
 
+  inode_lock_dir (dir->inode);
   while (inode_read_at (dir->inode, &e, sizeof e, dir->pos) == sizeof e)
     {
       dir->pos += sizeof e;
       if (e.in_use)
         {
           strlcpy (name, e.name, NAME_MAX + 1);
-          return true;
+          found = true;
+          break;
         }
     }
-  return false;
+  inode_unlock_dir (dir->inode);
+  return found;
 }
 
 /* Extracts a file name part from *SRCP into PART, and updates *SRCP so that the
@@ -11,6 +11,23 @@
 /* Partition that contains the file system. */
 struct block *fs_device;
 
+/* There is no global file system lock.  Namespace operations take
+   the directory lock of the directory they search or change, and
+   file data is protected by each inode's own lock, so processes
+   working in different directories and files proceed in parallel.
+
+   Locks are always acquired in this order:
+
+     1. Directory lock (inode_lock_dir), parent before child.
+        dir_lookup() drops the parent's lock before a path walk
+        moves on to the child, so at most dir_remove() holds two.
+     2. open_inodes_lock in inode.c.
+     3. An inode's inode_lock.
+     4. free_map_lock in free-map.c, then the free map file's own
+        inode_lock.
+     5. cache_blocks_lock, then a cache block's block_lock, then
+        cache_dirty_lock. */
+
 static void do_format (void);
 static bool is_root_dir(char* name);
 
@@ -24,6 +41,8 @@ filesys_init (bool format)
     PANIC ("No file system device found, can't initialize file system.");
 
   inode_init ();
+  file_init ();
+  dir_init ();
   free_map_init ();
   inode_cache_init();
 
@@ -7,7 +7,9 @@
 #include "filesys/free-map.h"
 #include "threads/malloc.h"
 #include "devices/block.h"
+#include "threads/slab.h"
 #include "threads/synch.h"
+#include "threads/trace.h"
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -20,6 +22,9 @@
 /* Total number of cache blocks */
 #define CACHE_BLOCKS_NUM 100
 
+/* Most dirty blocks that a flush keeps in flight at once */
+#define WRITE_BATCH 8
+
 
 struct cache_block {
     block_sector_t sector_idx; /* Sector on disk that this cache_block is used for*/
@@ -28,8 +33,12 @@ struct cache_block {
     bool dirty;                /* Dirty bit */
     int recently_used;         /* Flag for clock algorithm */
     bool valid;                /* True if this cache_block is caching a sector */
+    block_sector_t owner;      /* Sector of the inode whose data this dirty block holds, or NO_OWNER */
 };
 
+/* Owner of a cache_block that no inode has claimed */
+#define NO_OWNER ((block_sector_t) -1)
+
 /* Array of cache_block */
 struct cache_block cache_blocks[CACHE_BLOCKS_NUM];
 
@@ -75,9 +84,13 @@ struct inode {
     bool removed; /* True if deleted, false otherwise. */
     int deny_write_cnt; /* 0: writes ok, >0: deny writes. */
     struct inode_disk data; /* Inode content. */
-    struct lock inode_lock; /* Lock for the inode */
+    struct lock inode_lock; /* Lock for the inode's data, length, and deny_write_cnt */
+    struct lock dir_lock; /* Serializes entry lookups and changes if the inode is a directory */
 };
 
+static void cache_write_block(block_sector_t owner, block_sector_t sector, void *buffer);
+static void cache_discard(block_sector_t owner);
+
 /* Returns the block device sector that contains byte offset POS
    within INODE.
    Returns -1 if INODE does not contain data for a byte at offset
@@ -128,11 +141,30 @@ byte_to_sector(const struct inode *inode, off_t pos) {
    returns the same `struct inode'. */
 static struct list open_inodes;
 
+/* Protects open_inodes and every inode's open_cnt and removed.
+   Held only for list and counter updates, and for the cache read
+   of a newly opened inode, never across a data transfer. */
+static struct lock open_inodes_lock;
+
+/* Cache of struct inode. */
+static struct kmem_cache inode_cache;
+
+/* Constructs an inode in inode_cache.  The locks are released
+   by the time an inode is freed. */
+static void
+inode_ctor(void *inode_) {
+    struct inode *inode = inode_;
+    lock_init_named(&inode->inode_lock, "inode_lock");
+    lock_init_named(&inode->dir_lock, "dir_lock");
+}
+
 /* Initializes the inode module. */
 void
 inode_init(void) {
     most_recent_cache_search_bool = false;
     list_init(&open_inodes);
+    lock_init_named(&open_inodes_lock, "open_inodes_lock");
+    kmem_cache_init(&inode_cache, "inode", sizeof(struct inode), inode_ctor);
 }
 
 //Returns ceil(x/y)
@@ -143,8 +175,9 @@ ceil_int(int x, int y) {
 
 // Appends direct data blocks to the specified INODE. The number appended must be at most NUM_DIRECT minus the current number of directs blocks.
 // Does NOT modify the last DATA sector currently occupied (i.e. doesn't zero pad it).
+// OWNER is the inode the sectors are charged to for fsync.
 static bool
-inode_direct_append(struct inode_disk* disk_inode, size_t num_sectors_for_direct) {
+inode_direct_append(struct inode_disk* disk_inode, size_t num_sectors_for_direct, block_sector_t owner) {
     //Total number of DATA sectors across all pointers
     int total_current_sectors = ceil_int(disk_inode->length, BLOCK_SECTOR_SIZE);
     //Bound on upper end by NUM_DIRECT (lower bound is implicit due to being unable to have len < 0)
@@ -176,7 +209,7 @@ inode_direct_append(struct inode_disk* disk_inode, size_t num_sectors_for_direct
         int ind_data;
         for (ind_data = 0; ind_data < (int)num_sectors_for_direct; ind_data ++) {
             //block_write(fs_device, disk_inode->direct[num_direct_sectors_occupied + ind_data], zeros);
-            cache_write_at(disk_inode->direct[num_direct_sectors_occupied + ind_data], zeros);
+            cache_write_block(owner, disk_inode->direct[num_direct_sectors_occupied + ind_data], zeros);
         }
     }
     
@@ -194,7 +227,7 @@ inode_direct_append(struct inode_disk* disk_inode, size_t num_sectors_for_direct
 // Does NOT modify the last DATA sector currently occupied (i.e. doesn't zero pad it).
 // This method should only be called after the direct pointers are all completely in use, in order to maintain contiguity within the inode struct
 static bool
-inode_singly_indirect_append(struct inode_disk* disk_inode, size_t num_sectors_for_indirect) {
+inode_singly_indirect_append(struct inode_disk* disk_inode, size_t num_sectors_for_indirect, block_sector_t owner) {
     int total_current_sectors = ceil_int(disk_inode->length, BLOCK_SECTOR_SIZE);
     
     //Checks to make sure that we have at least completely filled the direct pointers
@@ -210,6 +243,12 @@ inode_singly_indirect_append(struct inode_disk* disk_inode, size_t num_sectors_f
     
     static char zeros [BLOCK_SECTOR_SIZE];
     
+    //Scratch copy of the indirect block; not static, since writers to different inodes may run concurrently
+    block_sector_t *singly_indirect_block_entries = malloc(BLOCK_SECTOR_SIZE);
+    if (singly_indirect_block_entries == NULL) {
+        return false;
+    }
+    
     //Return value
     bool indirect_allocation_passed = false;
     
@@ -224,7 +263,6 @@ inode_singly_indirect_append(struct inode_disk* disk_inode, size_t num_sectors_f
         //Now we need to allocate actual data blocks
         
         //Reads in entries inside the indirect block that are already present
-        static block_sector_t singly_indirect_block_entries[ENTRIES_PER_BLOCK];
         //block_read(fs_device, disk_inode->indirect, singly_indirect_block_entries);
         cache_read_at(disk_inode->indirect, singly_indirect_block_entries);
         
@@ -245,13 +283,13 @@ inode_singly_indirect_append(struct inode_disk* disk_inode, size_t num_sectors_f
         }
         else {
             //block_write(fs_device, disk_inode->indirect, singly_indirect_block_entries);
-            cache_write_at(disk_inode->indirect, singly_indirect_block_entries);
+            cache_write_block(owner, disk_inode->indirect, singly_indirect_block_entries);
 
             //Notice that only appended data is filled out; we don't want to zero out existing data entries
             int ind_data;
             for (ind_data = 0; ind_data < (int)num_sectors_for_indirect; ind_data ++) {
                 //block_write(fs_device, singly_indirect_block_entries[num_indirect_sectors_occupied + ind_data], zeros);
-                cache_write_at(singly_indirect_block_entries[num_indirect_sectors_occupied + ind_data], zeros);
+                cache_write_block(owner, singly_indirect_block_entries[num_indirect_sectors_occupied + ind_data], zeros);
             }
         }
     }
@@ -262,6 +300,7 @@ inode_singly_indirect_append(struct inode_disk* disk_inode, size_t num_sectors_f
         disk_inode->length = (total_current_sectors + num_sectors_for_indirect) * BLOCK_SECTOR_SIZE;
     }
     
+    free(singly_indirect_block_entries);
     return indirect_allocation_passed;
 }
 
@@ -271,7 +310,7 @@ inode_singly_indirect_append(struct inode_disk* disk_inode, size_t num_sectors_f
 // This method should only be called after the direct pointers AND singly indirect pointers are all completely in use,
 // in order to maintain contiguity within the inode struct
 static bool
-inode_doubly_indirect_append(struct inode_disk* disk_inode, size_t num_sectors_for_doubly_indirect) {
+inode_doubly_indirect_append(struct inode_disk* disk_inode, size_t num_sectors_for_doubly_indirect, block_sector_t owner) {
     int total_current_sectors = ceil_int(disk_inode->length, BLOCK_SECTOR_SIZE);
     
     //Check to make sure that we have filled in both direct pointers and (singly) indirect pointers
@@ -287,6 +326,17 @@ inode_doubly_indirect_append(struct inode_disk* disk_inode, size_t num_sectors_f
     
     static char zeros [BLOCK_SECTOR_SIZE];
     
+    //Scratch copies of indirect blocks; not static, since writers to different inodes may run concurrently
+    block_sector_t *doubly_indirect_block_entries = malloc(BLOCK_SECTOR_SIZE);
+    block_sector_t *last_occupied_entries = malloc(BLOCK_SECTOR_SIZE);
+    block_sector_t *remainder_block_entries = malloc(BLOCK_SECTOR_SIZE);
+    if (doubly_indirect_block_entries == NULL || last_occupied_entries == NULL || remainder_block_entries == NULL) {
+        free(doubly_indirect_block_entries);
+        free(last_occupied_entries);
+        free(remainder_block_entries);
+        return false;
+    }
+    
     //Return value
     bool double_indirect_allocation_passed = false;
     
@@ -299,7 +349,6 @@ inode_doubly_indirect_append(struct inode_disk* disk_inode, size_t num_sectors_f
         doubly_indirect_block_allocated = free_map_allocate(1, &disk_inode->doubly_indirect);
     }
     if (doubly_indirect_block_allocated || !allocate_doubly_indirect_block) {
-        static block_sector_t doubly_indirect_block_entries[ENTRIES_PER_BLOCK];
         //Read over current entries in doubly indirect block
         //block_read(fs_device, disk_inode->doubly_indirect, doubly_indirect_block_entries);
         cache_read_at(disk_inode->doubly_indirect, doubly_indirect_block_entries);
@@ -317,7 +366,6 @@ inode_doubly_indirect_append(struct inode_disk* disk_inode, size_t num_sectors_f
                 (int) num_sectors_for_doubly_indirect : ENTRIES_PER_BLOCK - last_sector_num_filled;
             
             //Fill in existing entries
-            static block_sector_t last_occupied_entries[ENTRIES_PER_BLOCK];
             //block_read(fs_device, last_occupied, last_occupied_entries);
             cache_read_at(last_occupied, last_occupied_entries);
             
@@ -335,6 +383,9 @@ inode_doubly_indirect_append(struct inode_disk* disk_inode, size_t num_sectors_f
                 for (temp_free = 0; temp_free < ind_last; temp_free++) {
                     free_map_release(last_occupied_entries[last_sector_num_filled + temp_free], 1);
                 }
+                free(doubly_indirect_block_entries);
+                free(last_occupied_entries);
+                free(remainder_block_entries);
                 return false;
             }
             else {
@@ -342,10 +393,10 @@ inode_doubly_indirect_append(struct inode_disk* disk_inode, size_t num_sectors_f
                 int ind_data;
                 for (ind_data = 0; ind_data < num_to_fill; ind_data++) {
                     //block_write(fs_device, last_occupied_entries[last_sector_num_filled + ind_data], zeros);
-                    cache_write_at(last_occupied_entries[last_sector_num_filled + ind_data], zeros);
+                    cache_write_block(owner, last_occupied_entries[last_sector_num_filled + ind_data], zeros);
                 }
                 //Write the filled out block back to memory
-                cache_write_at(last_occupied, last_occupied_entries);
+                cache_write_block(owner, last_occupied, last_occupied_entries);
 
                 //Change the number of sectors to be used in later calculations
                 effective_num_sectors -= num_to_fill;
@@ -385,7 +436,7 @@ inode_doubly_indirect_append(struct inode_disk* disk_inode, size_t num_sectors_f
             }
         } else {
             //block_write(fs_device, disk_inode->doubly_indirect, doubly_indirect_block_entries);
-            cache_write_at(disk_inode->doubly_indirect, doubly_indirect_block_entries);
+            cache_write_block(owner, disk_inode->doubly_indirect, doubly_indirect_block_entries);
 
             //Fill in "whole" indirect blocks, i.e. indirect blocks where all ENTRIES_PER_BLOCK entries are filled with useful info
             int ind_whole_single;
@@ -406,20 +457,19 @@ inode_doubly_indirect_append(struct inode_disk* disk_inode, size_t num_sectors_f
                     break;
                 } else {
                     //block_write(fs_device, doubly_indirect_block_entries[double_block_start + ind_whole_single], singly_indirect_block_entries);
-                    cache_write_at(doubly_indirect_block_entries[double_block_start + ind_whole_single], singly_indirect_block_entries);
+                    cache_write_block(owner, doubly_indirect_block_entries[double_block_start + ind_whole_single], singly_indirect_block_entries);
 
                     //Fill in zeroed out data
                     int ind_data;
                     for (ind_data = 0; ind_data < ENTRIES_PER_BLOCK; ind_data ++) {
                         //block_write(fs_device, singly_indirect_block_entries[ind_data], zeros);
-                        cache_write_at(singly_indirect_block_entries[ind_data], zeros);
+                        cache_write_block(owner, singly_indirect_block_entries[ind_data], zeros);
                     }
                 }
             }
             
             //Allocate remainder sectors if needed
             if (num_remaining_sectors != 0) {
-                static block_sector_t remainder_block_entries[ENTRIES_PER_BLOCK];
                 int temp;
                 for (temp = 0; temp < num_remaining_sectors; temp++) {
                     double_indirect_allocation_passed = free_map_allocate(1, &(remainder_block_entries[temp]));
@@ -434,13 +484,13 @@ inode_doubly_indirect_append(struct inode_disk* disk_inode, size_t num_sectors_f
                     }
                 } else {
                     //block_write(fs_device, doubly_indirect_block_entries[double_block_start + num_whole_blocks_needed], remainder_block_entries);
-                    cache_write_at(doubly_indirect_block_entries[double_block_start + num_whole_blocks_needed], remainder_block_entries);
+                    cache_write_block(owner, doubly_indirect_block_entries[double_block_start + num_whole_blocks_needed], remainder_block_entries);
 
                     //Fill in zeroed out data
                     int ind_data;
                     for (ind_data = 0; ind_data < num_remaining_sectors; ind_data ++) {
                         //block_write(fs_device, remainder_block_entries[ind_data], zeros);
-                        cache_write_at(remainder_block_entries[ind_data], zeros);
+                        cache_write_block(owner, remainder_block_entries[ind_data], zeros);
                     }
                 }
             }
@@ -453,6 +503,9 @@ inode_doubly_indirect_append(struct inode_disk* disk_inode, size_t num_sectors_f
         disk_inode->length = (total_current_sectors + num_sectors_for_doubly_indirect) * BLOCK_SECTOR_SIZE;
     }
     
+    free(doubly_indirect_block_entries);
+    free(last_occupied_entries);
+    free(remainder_block_entries);
     return double_indirect_allocation_passed;
 }
 
@@ -491,15 +544,15 @@ inode_create(block_sector_t sector, off_t length, int32_t is_directory) {
         
         if (direct_sectors_needed > 0) {
             //printf("Direct allocation needed\n");
-            direct_allocation_passed = inode_direct_append(disk_inode, direct_sectors_needed);
+            direct_allocation_passed = inode_direct_append(disk_inode, direct_sectors_needed, sector);
         }
         if (indirect_sectors_needed > 0) {
             //printf("Indirect allocation needed\n");
-            indirect_allocation_passed = inode_singly_indirect_append(disk_inode, indirect_sectors_needed);
+            indirect_allocation_passed = inode_singly_indirect_append(disk_inode, indirect_sectors_needed, sector);
         }
         if (doubly_indirect_sectors_needed > 0) {
             //printf("Doubly indirect allocation needed\n");
-            doubly_indirect_allocation_passed = inode_doubly_indirect_append(disk_inode, doubly_indirect_sectors_needed);
+            doubly_indirect_allocation_passed = inode_doubly_indirect_append(disk_inode, doubly_indirect_sectors_needed, sector);
         }
         
         success = direct_allocation_passed && indirect_allocation_passed && doubly_indirect_allocation_passed;
@@ -511,7 +564,7 @@ inode_create(block_sector_t sector, off_t length, int32_t is_directory) {
             disk_inode->length = length;
             disk_inode->magic = INODE_MAGIC;  
             //block_write(fs_device, sector, disk_inode);
-            cache_write_at(sector, disk_inode);
+            cache_write_block(sector, sector, disk_inode);
         }
         free(disk_inode);
     }
@@ -526,30 +579,38 @@ inode_open(block_sector_t sector) {
     struct list_elem *e;
     struct inode *inode;
 
+    lock_acquire(&open_inodes_lock);
+
     /* Check whether this inode is already open. */
     for (e = list_begin(&open_inodes); e != list_end(&open_inodes);
             e = list_next(e)) {
         inode = list_entry(e, struct inode, elem);
         if (inode->sector == sector) {
-            inode_reopen(inode);
+            inode->open_cnt++;
+            lock_release(&open_inodes_lock);
             return inode;
         }
     }
 
     /* Allocate memory. */
-    inode = malloc(sizeof *inode);
-    if (inode == NULL)
+    inode = kmem_cache_alloc(&inode_cache);
+    if (inode == NULL) {
+        lock_release(&open_inodes_lock);
         return NULL;
+    }
 
-    /* Initialize. */
-    lock_init(&inode->inode_lock);
-    list_push_front(&open_inodes, &inode->elem);
+    /* Initialize.  The inode is read in before it is published on
+       open_inodes so that no other opener can see it half-filled;
+       inode sectors are nearly always cache hits.  The locks were
+       set up by inode_ctor(). */
     inode->sector = sector;
     inode->open_cnt = 1;
     inode->deny_write_cnt = 0;
     inode->removed = false;
     //block_read(fs_device, inode->sector, &inode->data);
     cache_read_at(inode->sector, &inode->data);
+    list_push_front(&open_inodes, &inode->elem);
+    lock_release(&open_inodes_lock);
     
     return inode;
 }
@@ -557,8 +618,11 @@ inode_open(block_sector_t sector) {
 /* Reopens and returns INODE. */
 struct inode *
 inode_reopen(struct inode *inode) {
-    if (inode != NULL)
+    if (inode != NULL) {
+        lock_acquire(&open_inodes_lock);
         inode->open_cnt++;
+        lock_release(&open_inodes_lock);
+    }
     return inode;
 }
 
@@ -609,22 +673,34 @@ static void release_all_entries(struct inode* in) {
    If INODE was also a removed inode, frees its blocks. */
 void
 inode_close(struct inode *inode) {
+    bool last;
+
     /* Ignore null pointer. */
     if (inode == NULL)
         return;
 
-    /* Release resources if this was the last opener. */
-    if (--inode->open_cnt == 0) {
-        /* Remove from inode list and release lock. */
+    lock_acquire(&open_inodes_lock);
+    last = --inode->open_cnt == 0;
+    if (last) {
+        /* Remove from inode list; no one can find it any more. */
         list_remove(&inode->elem);
+    }
+    lock_release(&open_inodes_lock);
 
-        /* Deallocate blocks if removed. */
+    /* Release resources if this was the last opener. */
+    if (last) {
+        /* Deallocate blocks if removed.  Their cached contents are
+           garbage now, so they must not be written back later. */
         if (inode->removed) {
+            cache_discard(inode->sector);
             free_map_release(inode->sector, 1);
             release_all_entries(inode);
         }
 
-        free(inode);
+        /* The inode's dirty blocks stay in the cache, tagged with
+           its sector, so that they are written back lazily and
+           fsync() still finds them if it is reopened. */
+        kmem_cache_free(&inode_cache, inode);
     }
 }
 
@@ -633,7 +709,9 @@ inode_close(struct inode *inode) {
 void
 inode_remove(struct inode *inode) {
     ASSERT(inode != NULL);
+    lock_acquire(&open_inodes_lock);
     inode->removed = true;
+    lock_release(&open_inodes_lock);
 }
 
 /* Reads SIZE bytes from INODE into BUFFER, starting at position OFFSET.
@@ -701,11 +779,13 @@ inode_write_at(struct inode *inode, const void *buffer_, off_t size,
     off_t bytes_written = 0;
     uint8_t *bounce = NULL;
 
-    if (inode->deny_write_cnt)
-        return 0;
-    
     lock_acquire(&inode->inode_lock);
     
+    if (inode->deny_write_cnt) {
+        lock_release(&inode->inode_lock);
+        return 0;
+    }
+    
     //Bool to determine whether to go on to actual writing portion depending on success of memory allocation
     bool proceed = true;
     
@@ -750,21 +830,27 @@ inode_write_at(struct inode *inode, const void *buffer_, off_t size,
         //The inode's length may change in these calls (only is successfully allocated), but is overwritten if all succeeded.
         if (diff_direct > 0) {
             //printf("Write direct allocation\n");
-            direct_passed = inode_direct_append(&inode->data, diff_direct);
+            direct_passed = inode_direct_append(&inode->data, diff_direct, inode->sector);
         }
         if (diff_indirect > 0) {
             //printf("Write indirect allocation\n");
-            indirect_passed = inode_singly_indirect_append(&inode->data, diff_indirect);
+            indirect_passed = inode_singly_indirect_append(&inode->data, diff_indirect, inode->sector);
         }
         if (diff_double_indirect > 0) {
             //printf("Write doubly indirect allocation\n");
-            doubly_indirect_passed = inode_doubly_indirect_append(&inode->data, diff_double_indirect);
+            doubly_indirect_passed = inode_doubly_indirect_append(&inode->data, diff_double_indirect, inode->sector);
         }     
         
         //We only care about zero padding the last current sector if all of the extra block allocations from previously were executed successfully
         if (direct_passed && indirect_passed && doubly_indirect_passed) {
             block_sector_t last_sector = len == 0 ? byte_to_sector(inode, 0) : byte_to_sector(inode, len-1);
-            static char data_buff[BLOCK_SECTOR_SIZE];
+            //Shares the bounce buffer below; a static buffer would be clobbered by writers to other inodes
+            bounce = malloc(BLOCK_SECTOR_SIZE);
+            if (bounce == NULL) {
+                lock_release(&inode->inode_lock);
+                return -1;
+            }
+            uint8_t *data_buff = bounce;
             //block_read(fs_device, last_sector, data_buff);
             cache_read_at(last_sector, data_buff);
 
@@ -781,7 +867,7 @@ inode_write_at(struct inode *inode, const void *buffer_, off_t size,
             }
             //Write back zeroed out entries
             //block_write(fs_device, last_sector, data_buff);
-            cache_write_at(last_sector, data_buff);
+            cache_write_block(inode->sector, last_sector, data_buff);
             
             //After everything else succeeded, we must update the length again, because the sector allocation calls only update length at
             //multiples of BLOCK_SECTOR_SIZE
@@ -789,11 +875,12 @@ inode_write_at(struct inode *inode, const void *buffer_, off_t size,
             //printf("Write length has now been set to %d\n", (int) inode->data.length);
 
             //Write altered inode_disk back to disk
-            cache_write_at(inode->sector, &inode->data);
+            cache_write_block(inode->sector, inode->sector, &inode->data);
         }
         else {
             //printf("Allocation failed\n");
             //proceed = false;
+            lock_release(&inode->inode_lock);
             return -1;
         }
     }
@@ -821,7 +908,7 @@ inode_write_at(struct inode *inode, const void *buffer_, off_t size,
             if (sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE) {
                 /* Write full sector directly to disk. */
                 //block_write(fs_device, sector_idx, buffer + bytes_written);
-                cache_write_at (sector_idx, (void *) (buffer + bytes_written));
+                cache_write_block (inode->sector, sector_idx, (void *) (buffer + bytes_written));
             } else {
                 /* We need a bounce buffer. */
                 if (bounce == NULL) {
@@ -840,7 +927,7 @@ inode_write_at(struct inode *inode, const void *buffer_, off_t size,
                     memset(bounce, 0, BLOCK_SECTOR_SIZE);
                 memcpy(bounce + sector_ofs, buffer + bytes_written, chunk_size);
                 //block_write(fs_device, sector_idx, bounce);
-                cache_write_at (sector_idx, bounce);
+                cache_write_block (inode->sector, sector_idx, bounce);
             }
 
             /* Advance. */
@@ -859,8 +946,10 @@ inode_write_at(struct inode *inode, const void *buffer_, off_t size,
    May be called at most once per inode opener. */
 void
 inode_deny_write(struct inode *inode) {
+    lock_acquire(&inode->inode_lock);
     inode->deny_write_cnt++;
     ASSERT(inode->deny_write_cnt <= inode->open_cnt);
+    lock_release(&inode->inode_lock);
 }
 
 /* Re-enables writes to INODE.
@@ -868,9 +957,11 @@ inode_deny_write(struct inode *inode) {
    inode_deny_write() on the inode, before closing the inode. */
 void
 inode_allow_write(struct inode *inode) {
+    lock_acquire(&inode->inode_lock);
     ASSERT(inode->deny_write_cnt > 0);
     ASSERT(inode->deny_write_cnt <= inode->open_cnt);
     inode->deny_write_cnt--;
+    lock_release(&inode->inode_lock);
 }
 
 /* Returns the length, in bytes, of INODE's data. */
@@ -884,14 +975,70 @@ void inode_cache_init()
   int index;
   for (index = 0; index < CACHE_BLOCKS_NUM; index++)
   {
-    lock_init(&cache_blocks[index].block_lock);
+    lock_init_named(&cache_blocks[index].block_lock, "cache block_lock");
     cache_blocks[index].data = malloc(BLOCK_SECTOR_SIZE);
     cache_blocks[index].dirty = false;
     cache_blocks[index].recently_used = 0;
     cache_blocks[index].valid = false;
+    cache_blocks[index].owner = NO_OWNER;
   }
   clock_index = 0;
-  lock_init(&cache_blocks_lock);
+  lock_init_named(&cache_blocks_lock, "cache_blocks_lock");
+}
+
+/* Marks B, whose block_lock the caller holds, as dirty.  If OWNER is
+   not NO_OWNER, B is tagged as holding data of the inode in sector
+   OWNER, so that inode_flush() can find it, even after that inode
+   has been closed and opened again. */
+static void
+cache_mark_dirty(struct cache_block *b, block_sector_t owner)
+{
+  b->dirty = true;
+  if (owner != NO_OWNER)
+    b->owner = owner;
+}
+
+/* Writes B, whose block_lock the caller holds, back to disk if it
+   is dirty, and forgets its owner. */
+static void
+cache_writeback(struct cache_block *b)
+{
+  if (b->valid && b->dirty)
+  {
+    block_write(fs_device, b->sector_idx, b->data);
+    b->dirty = false;
+  }
+  b->owner = NO_OWNER;
+}
+
+/* Writes back the N dirty blocks in BATCH, whose block_locks the
+   caller holds, with all of the writes in flight at once.  On a
+   striped fs_device, neighbouring sectors land on different
+   members, so the writes go out on several channels together.
+   Forgets the blocks' owners and releases their block_locks. */
+static void
+cache_write_batch(struct cache_block **batch, size_t n)
+{
+  struct block_request reqs[WRITE_BATCH];
+  size_t i;
+
+  ASSERT(n <= WRITE_BATCH);
+  for (i = 0; i < n; i++)
+  {
+    reqs[i].write = true;
+    reqs[i].sector = batch[i]->sector_idx;
+    reqs[i].cnt = 1;
+    reqs[i].buffer = batch[i]->data;
+    reqs[i].done = NULL;
+    block_submit(fs_device, &reqs[i]);
+  }
+  for (i = 0; i < n; i++)
+  {
+    block_wait(&reqs[i]);
+    batch[i]->dirty = false;
+    batch[i]->owner = NO_OWNER;
+    lock_release(&batch[i]->block_lock);
+  }
 }
 
 void cache_read_at(block_sector_t sector, void *buffer)
@@ -915,6 +1062,7 @@ void cache_read_at(block_sector_t sector, void *buffer)
     {
       lock_release(&cache_blocks[index].block_lock);
       cache_read_at(sector, buffer);
+      return;
     }
   }
   else
@@ -941,11 +1089,10 @@ void cache_read_at(block_sector_t sector, void *buffer)
         }
       }
     }
+    TRACE(TRACE_CACHE_MISS, sector, 0,
+          cache_blocks[index].valid ? cache_blocks[index].sector_idx : (block_sector_t) -1);
     clock_index = index;
-    if (cache_blocks[index].dirty == true)
-    {
-      block_write (fs_device, cache_blocks[index].sector_idx, cache_blocks[index].data);
-    }
+    cache_writeback(&cache_blocks[index]);
     cache_blocks[index].sector_idx = sector;
     cache_blocks[index].valid = true;
     cache_blocks[index].dirty = false;
@@ -958,6 +1105,15 @@ void cache_read_at(block_sector_t sector, void *buffer)
 }
 
 void cache_write_at(block_sector_t sector, void *buffer)
+{
+  cache_write_block(NO_OWNER, sector, buffer);
+}
+
+/* Writes BUFFER to SECTOR through the cache.  If OWNER is not
+   NO_OWNER, the cached sector is charged to the inode in sector
+   OWNER. */
+static void
+cache_write_block(block_sector_t owner, block_sector_t sector, void *buffer)
 {
   int index;
   bool find_a_cache_block;
@@ -977,7 +1133,8 @@ void cache_write_at(block_sector_t sector, void *buffer)
     if (cache_blocks[index].sector_idx != sector)
     {
       lock_release(&cache_blocks[index].block_lock);
-      cache_write_at(sector, buffer);
+      cache_write_block(owner, sector, buffer);
+      return;
     }
   }
   else
@@ -1004,11 +1161,10 @@ void cache_write_at(block_sector_t sector, void *buffer)
         }
       }
     }
+    TRACE(TRACE_CACHE_MISS, sector, 1,
+          cache_blocks[index].valid ? cache_blocks[index].sector_idx : (block_sector_t) -1);
     clock_index = index;
-    if (cache_blocks[index].dirty == true)
-    {
-      block_write (fs_device, cache_blocks[index].sector_idx, cache_blocks[index].data);
-    }
+    cache_writeback(&cache_blocks[index]);
     cache_blocks[index].sector_idx = sector;
     cache_blocks[index].valid = true;
     cache_blocks[index].recently_used = 1;
@@ -1017,19 +1173,110 @@ void cache_write_at(block_sector_t sector, void *buffer)
     block_read(fs_device, cache_blocks[index].sector_idx, cache_blocks[index].data);
   }
   memcpy(cache_blocks[index].data, buffer, BLOCK_SECTOR_SIZE);
-  cache_blocks[index].dirty = true;
+  cache_mark_dirty(&cache_blocks[index], owner);
   lock_release(&cache_blocks[index].block_lock);
 }
 
-void cache_flush(void)
+/* Writes back every dirty cached sector that belongs to INODE,
+   including its inode and indirect blocks, in ascending sector
+   order and WRITE_BATCH at a time.  Other dirty sectors are left
+   in the cache. */
+void inode_flush(struct inode *inode)
+{
+  struct cache_block *batch[WRITE_BATCH];
+  int order[CACHE_BLOCKS_NUM];
+  int cnt = 0;
+  size_t n = 0;
+  int index, i;
+
+  /* Only the blocks dirty when we start are written, so a
+     concurrent writer cannot keep us here forever.  The owners
+     and sectors are looked at without locks, which only affects
+     the order, so each block is checked again under its lock. */
+  for (index = 0; index < CACHE_BLOCKS_NUM; index++)
+  {
+    if (cache_blocks[index].owner != inode->sector)
+      continue;
+    for (i = cnt; i > 0 && cache_blocks[order[i - 1]].sector_idx > cache_blocks[index].sector_idx; i--)
+      order[i] = order[i - 1];
+    order[i] = index;
+    cnt++;
+  }
+
+  for (i = 0; i < cnt; i++)
+  {
+    struct cache_block *b = &cache_blocks[order[i]];
+    lock_acquire(&b->block_lock);
+    if (b->valid && b->dirty && b->owner == inode->sector)
+    {
+      batch[n++] = b;
+      if (n == WRITE_BATCH)
+      {
+        cache_write_batch(batch, n);
+        n = 0;
+      }
+    }
+    else
+      lock_release(&b->block_lock);
+  }
+  cache_write_batch(batch, n);
+}
+
+/* Marks every cached sector of the inode in sector OWNER clean,
+   without writing it back.  Called when that inode is removed,
+   before its sectors are released, since whatever is cached for
+   them no longer matters and must not overwrite their next use. */
+static void
+cache_discard(block_sector_t owner)
 {
   int index;
   for (index = 0; index < CACHE_BLOCKS_NUM; index++)
   {
-    if (cache_blocks[index].valid && cache_blocks[index].dirty)
+    struct cache_block *b = &cache_blocks[index];
+    if (b->owner != owner)
+      continue;
+    lock_acquire(&b->block_lock);
+    if (b->owner == owner)
     {
-      block_write(fs_device, cache_blocks[index].sector_idx, cache_blocks[index].data);
+      b->dirty = false;
+      b->owner = NO_OWNER;
     }
+    lock_release(&b->block_lock);
+  }
+}
+
+/* Writes back every dirty sector in the cache.  Unlike
+   cache_flush(), the cache stays usable afterwards. */
+void cache_sync(void)
+{
+  struct cache_block *batch[WRITE_BATCH];
+  size_t n = 0;
+  int index;
+  for (index = 0; index < CACHE_BLOCKS_NUM; index++)
+  {
+    struct cache_block *b = &cache_blocks[index];
+    lock_acquire(&b->block_lock);
+    if (b->valid && b->dirty)
+    {
+      batch[n++] = b;
+      if (n == WRITE_BATCH)
+      {
+        cache_write_batch(batch, n);
+        n = 0;
+      }
+    }
+    else
+      lock_release(&b->block_lock);
+  }
+  cache_write_batch(batch, n);
+}
+
+void cache_flush(void)
+{
+  int index;
+  for (index = 0; index < CACHE_BLOCKS_NUM; index++)
+  {
+    cache_writeback(&cache_blocks[index]);
     free(cache_blocks[index].data);
   } 
 }
@@ -1051,6 +1298,17 @@ int inode_open_cnt(struct inode * i) {
     return i->open_cnt;
 }
 
+/* Acquires the namespace lock of directory inode I.  See the lock
+   order in filesys.c. */
+void inode_lock_dir(struct inode *i) {
+    lock_acquire(&i->dir_lock);
+}
+
+/* Releases the namespace lock of directory inode I. */
+void inode_unlock_dir(struct inode *i) {
+    lock_release(&i->dir_lock);
+}
+
 bool inode_is_root(struct inode * inode)
 {
     if (inode->sector == ROOT_DIR_SECTOR)
@@ -32,11 +32,15 @@ void inode_cache_init(void);
 void cache_read_at(block_sector_t sector, void *buffer);
 void cache_write_at(block_sector_t sector, void *buffer);
 void cache_flush(void);
+void cache_sync(void);
+void inode_flush(struct inode *);
 
 
 void set_root_is_directory(void);
 bool is_dir(struct inode *);
 int inode_open_cnt(struct inode *);
+void inode_lock_dir(struct inode *);
+void inode_unlock_dir(struct inode *);
 bool inode_is_root(struct inode *);
 
 bool most_recent_cache_search(void);
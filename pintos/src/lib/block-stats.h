@@ -0,0 +1,37 @@
+#ifndef __LIB_BLOCK_STATS_H
+#define __LIB_BLOCK_STATS_H
+
+#include <stdint.h>
+
+/* I/O statistics for a block device, kept by the kernel's block
+   layer and returned to user programs by the block_stats system
+   call. */
+
+/* Number of latency histogram buckets.  Bucket 0 counts requests
+   that took less than 2 us, bucket I, for 0 < I < BLOCK_HIST_CNT
+   - 1, those that took from 2**I up to 2**(I+1) us, and the last
+   bucket everything slower. */
+#define BLOCK_HIST_CNT 20
+
+struct block_stats
+  {
+    uint64_t read_cnt;          /* Sectors read. */
+    uint64_t write_cnt;         /* Sectors written. */
+    uint64_t read_bytes;        /* Bytes read. */
+    uint64_t write_bytes;       /* Bytes written. */
+
+    uint64_t request_cnt;       /* Requests completed. */
+    uint64_t seq_cnt;           /* Requests that began where the
+                                   previous one ended. */
+    uint64_t random_cnt;        /* All other requests. */
+    int64_t service_us;         /* Total submission-to-completion
+                                   time, in microseconds. */
+    int32_t in_flight;          /* Requests submitted, not completed. */
+    int32_t max_in_flight;      /* Most ever in flight at once. */
+
+    /* Submission-to-completion latency histograms. */
+    uint32_t read_hist[BLOCK_HIST_CNT];
+    uint32_t write_hist[BLOCK_HIST_CNT];
+  };
+
+#endif /* lib/block-stats.h */
@@ -34,7 +34,12 @@ enum
     SYS_CACHE_HIT,               /* Returns if the most recent buffer cache search hit or not*/
     SYS_CACHE_RESET,              /* Resets the buffer cache */
 
-    SYS_WRITE_CNT                 /* Gets the block device "fs_device"'s write count */
+    SYS_WRITE_CNT,                /* Gets the block device "fs_device"'s write count */
+
+    SYS_FSYNC,                    /* Writes back one file's cached sectors */
+    SYS_SYNC,                     /* Writes back every dirty cached sector */
+
+    SYS_BLOCK_STATS               /* Gets "fs_device"'s I/O statistics */
   };
 
 #endif /* lib/syscall-nr.h */
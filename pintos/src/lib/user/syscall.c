@@ -200,3 +200,15 @@ void buffer_cache_reset(void) {
 int get_write_cnt(void) {
     return syscall0(SYS_WRITE_CNT);
 }
+
+bool fsync(int fd) {
+    return syscall1(SYS_FSYNC, fd);
+}
+
+void sync(void) {
+    syscall0(SYS_SYNC);
+}
+
+void block_stats(struct block_stats *stats) {
+    syscall1(SYS_BLOCK_STATS, stats);
+}
@@ -3,6 +3,7 @@
 
 #include <stdbool.h>
 #include <debug.h>
+#include <block-stats.h>
 
 /* Process identifier. */
 typedef int pid_t;
@@ -51,4 +52,9 @@ void buffer_cache_reset(void);
 
 int get_write_cnt(void);
 
+bool fsync(int fd);
+void sync(void);
+
+void block_stats(struct block_stats *);
+
 #endif /* lib/user/syscall.h */
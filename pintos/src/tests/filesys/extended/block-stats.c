@@ -0,0 +1,69 @@
+/* Writes a file one sector at a time and checks, through the
+   block_stats system call, what the file system device saw when
+   the file was fsync'd: the data went out as writes with their
+   latencies recorded, nothing had to be read, and the sectors,
+   which were allocated in order, were mostly written in order. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SECTOR_CNT 32
+
+static char sector[512];
+
+/* Returns how many requests landed in HIST in AFTER but not in
+   BEFORE. */
+static uint32_t
+hist_delta (const uint32_t before[BLOCK_HIST_CNT],
+            const uint32_t after[BLOCK_HIST_CNT])
+{
+  uint32_t delta = 0;
+  int i;
+
+  for (i = 0; i < BLOCK_HIST_CNT; i++)
+    delta += after[i] - before[i];
+  return delta;
+}
+
+void
+test_main (void)
+{
+  struct block_stats before, after;
+  uint64_t seq, rand;
+  int fd, i;
+
+  CHECK (create ("stats", 0), "create \"stats\"");
+  CHECK ((fd = open ("stats")) > 1, "open \"stats\"");
+  msg ("write \"stats\"");
+  for (i = 0; i < SECTOR_CNT; i++)
+    {
+      memset (sector, 'a' + i % 26, sizeof sector);
+      if (write (fd, sector, sizeof sector) != (int) sizeof sector)
+        fail ("write of sector %d failed", i);
+    }
+
+  block_stats (&before);
+  CHECK (fsync (fd), "fsync \"stats\"");
+  block_stats (&after);
+  close (fd);
+
+  if (after.write_bytes - before.write_bytes < SECTOR_CNT * sizeof sector)
+    fail ("fsync wrote only %llu bytes",
+          (unsigned long long) (after.write_bytes - before.write_bytes));
+  msg ("fsync wrote the file's data");
+
+  if (hist_delta (before.write_hist, after.write_hist) == 0)
+    fail ("no write latencies recorded");
+  if (hist_delta (before.read_hist, after.read_hist) != 0)
+    fail ("fsync read from the device");
+  msg ("write latencies recorded, no reads");
+
+  seq = after.seq_cnt - before.seq_cnt;
+  rand = after.random_cnt - before.random_cnt;
+  if (seq <= rand)
+    fail ("%llu sequential requests, %llu random",
+          (unsigned long long) seq, (unsigned long long) rand);
+  msg ("fsync was mostly sequential");
+}
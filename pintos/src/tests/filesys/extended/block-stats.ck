@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(block-stats) begin
+(block-stats) create "stats"
+(block-stats) open "stats"
+(block-stats) write "stats"
+(block-stats) fsync "stats"
+(block-stats) fsync wrote the file's data
+(block-stats) write latencies recorded, no reads
+(block-stats) fsync was mostly sequential
+(block-stats) end
+EOF
+pass;
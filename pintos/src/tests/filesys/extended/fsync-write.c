@@ -0,0 +1,41 @@
+/*
+ Tests that fsync writes back the dirty sectors of one file, and
+ that a second fsync with nothing dirty causes no device writes.
+ */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static char buf[4096];
+
+void
+test_main(void) {
+    
+    char* file_name = "test3";
+    int fd;
+    
+    CHECK (create (file_name, 0), "create \"%s\"", file_name);
+    CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+    
+    //Eight sectors of data, plus the inode, all dirty in the cache
+    memset (buf, 'f', sizeof buf);
+    CHECK (write (fd, buf, sizeof buf) == (int) sizeof buf, "write \"%s\"", file_name);
+    
+    int before = get_write_cnt();
+    CHECK (fsync (fd), "fsync \"%s\"", file_name);
+    int after = get_write_cnt();
+    
+    CHECK (after - before >= 8, "Verifying fsync wrote the file's sectors...");
+    
+    CHECK (fsync (fd), "fsync \"%s\" again", file_name);
+    CHECK (get_write_cnt() == after, "Verifying clean file needs no writes...");
+    
+    CHECK (!fsync (fd + 1), "fsync bad fd");
+    
+    sync();
+    msg ("sync");
+    
+    close(fd);
+}
@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(fsync-write) begin
+(fsync-write) create "test3"
+(fsync-write) open "test3"
+(fsync-write) write "test3"
+(fsync-write) fsync "test3"
+(fsync-write) Verifying fsync wrote the file's sectors...
+(fsync-write) fsync "test3" again
+(fsync-write) Verifying clean file needs no writes...
+(fsync-write) fsync bad fd
+(fsync-write) sync
+(fsync-write) end
+EOF
+pass;
@@ -20,8 +20,11 @@
 #include "threads/loader.h"
 #include "threads/malloc.h"
 #include "threads/palloc.h"
+#include "threads/profile.h"
 #include "threads/pte.h"
+#include "threads/synch.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #include "userprog/exception.h"
@@ -34,6 +37,8 @@
 #ifdef FILESYS
 #include "devices/block.h"
 #include "devices/ide.h"
+#include "devices/partition.h"
+#include "devices/ramdisk.h"
 #include "filesys/filesys.h"
 #include "filesys/fsutil.h"
 #endif
@@ -45,6 +50,12 @@ uint32_t *init_page_dir;
 /* -f: Format the file system? */
 static bool format_filesys;
 
+/* -stripe, -stripe-chunk: Members of striped device md0, as a
+   comma-separated list of block device names, and its chunk size
+   in sectors. */
+static char *stripe_members;
+static block_sector_t stripe_chunk = 8;
+
 /* -filesys, -scratch, -swap: Names of block devices to use,
    overriding the defaults. */
 static const char *filesys_bdev_name;
@@ -98,6 +109,7 @@ main (void)
   palloc_init (user_page_limit);
   malloc_init ();
   paging_init ();
+  profile_init ();
 
   /* Segmentation. */
 #ifdef USERPROG
@@ -108,6 +120,7 @@ main (void)
   /* Initialize interrupt handlers. */
   intr_init ();
   timer_init ();
+  trace_init ();
   kbd_init ();
   input_init ();
 #ifdef USERPROG
@@ -123,6 +136,9 @@ main (void)
 #ifdef FILESYS
   /* Initialize file system. */
   ide_init ();
+  ramdisk_init ();
+  if (stripe_members != NULL)
+    partition_stripe ("md0", stripe_members, stripe_chunk);
   locate_block_devices ();
   filesys_init (format_filesys);
 #endif
@@ -247,6 +263,12 @@ parse_options (char **argv)
         filesys_bdev_name = value;
       else if (!strcmp (name, "-scratch"))
         scratch_bdev_name = value;
+      else if (!strcmp (name, "-ramdisk"))
+        ramdisk_configure (value != NULL ? atoi (value) : 0);
+      else if (!strcmp (name, "-stripe"))
+        stripe_members = value;
+      else if (!strcmp (name, "-stripe-chunk"))
+        stripe_chunk = value != NULL ? atoi (value) : 0;
 #ifdef VM
       else if (!strcmp (name, "-swap"))
         swap_bdev_name = value;
@@ -256,6 +278,14 @@ parse_options (char **argv)
         random_init (atoi (value));
       else if (!strcmp (name, "-mlfqs"))
         thread_mlfqs = true;
+      else if (!strcmp (name, "-buddy"))
+        palloc_buddy = true;
+      else if (!strcmp (name, "-lockstat"))
+        lock_stats_enabled = true;
+      else if (!strcmp (name, "-profile"))
+        profile_configure (value != NULL ? atoi (value) : 0);
+      else if (!strcmp (name, "-trace"))
+        trace_enabled = true;
 #ifdef USERPROG
       else if (!strcmp (name, "-ul"))
         user_page_limit = atoi (value);
@@ -373,12 +403,20 @@ usage (void)
           "  -f                 Format file system device during startup.\n"
           "  -filesys=BDEV      Use BDEV for file system instead of default.\n"
           "  -scratch=BDEV      Use BDEV for scratch instead of default.\n"
+          "  -ramdisk=SIZE      Add a SIZE kB RAM disk, named rd0, rd1, ...\n"
+          "  -stripe=BDEV,BDEV...  Stripe md0 across the BDEVs.\n"
+          "  -stripe-chunk=N    Put N sectors per chunk on each stripe member.\n"
 #ifdef VM
           "  -swap=BDEV         Use BDEV for swap instead of default.\n"
 #endif
 #endif
           "  -rs=SEED           Set random number seed to SEED.\n"
           "  -mlfqs             Use multi-level feedback queue scheduler.\n"
+          "  -buddy             Use the buddy system page allocator.\n"
+          "  -lockstat          Print lock contention statistics at shutdown.\n"
+          "  -profile[=DEPTH]   Sample kernel EIPs, and DEPTH callers, to\n"
+          "                     print at shutdown.\n"
+          "  -trace             Record tracepoints, to print at shutdown.\n"
 #ifdef USERPROG
           "  -ul=COUNT          Limit user memory to COUNT pages.\n"
 #endif
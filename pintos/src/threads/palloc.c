@@ -2,13 +2,16 @@
 #include <bitmap.h>
 #include <debug.h>
 #include <inttypes.h>
+#include <list.h>
 #include <round.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/interrupt.h"
 #include "threads/loader.h"
 #include "threads/synch.h"
+#include "threads/thread.h"
 #include "threads/vaddr.h"
 
 /* Page allocator.  Hands out memory in page-size (or
@@ -23,7 +26,23 @@
 
    By default, half of system RAM is given to the kernel pool and
    half to the user pool.  That should be huge overkill for the
-   kernel pool, but that's just fine for demonstration purposes. */
+   kernel pool, but that's just fine for demonstration purposes.
+
+   By default each pool finds free runs of pages by scanning its
+   bitmap, which takes time proportional to the size of the pool.
+   With the "-buddy" option, each pool is instead managed as a
+   binary buddy system: free memory is kept as blocks of 2**ORDER
+   pages, aligned to their size, on one free list per order.  An
+   allocation of N pages splits the smallest free block of at
+   least N pages and returns the pages past N to the free lists;
+   freeing merges a block with its "buddy", the other half of the
+   block twice its size, for as long as the buddy is free too.
+   Both take O(log n) time.  The bitmap is still kept, to catch
+   double frees. */
+
+/* Buddy system block orders are 0...BUDDY_ORDER_CNT - 1, so the
+   largest block, and the largest allocation, is 4 MB. */
+#define BUDDY_ORDER_CNT 11
 
 /* A memory pool. */
 struct pool
@@ -31,14 +50,32 @@ struct pool
     struct lock lock;                   /* Mutual exclusion. */
     struct bitmap *used_map;            /* Bitmap of free pages. */
     uint8_t *base;                      /* Base of pool. */
+    const char *name;                   /* Name, for statistics. */
+    size_t fail_cnt;                    /* Allocations that failed. */
+
+    /* Buddy system only.  Interrupts must be off to access these
+       members, because pages are freed while switching threads. */
+    struct list free_lists[BUDDY_ORDER_CNT]; /* Free blocks by order. */
+    uint8_t *free_order;                /* For each page that heads a
+                                           free block, 1 + its order,
+                                           otherwise 0. */
+    size_t free_cnt;                    /* Number of free pages. */
   };
 
+/* If false (default), use the bitmap allocator.
+   If true, use the buddy system.
+   Controlled by kernel command-line option "-buddy". */
+bool palloc_buddy;
+
 /* Two pools: one for kernel data, one for user pages. */
 static struct pool kernel_pool, user_pool;
 
 static void init_pool (struct pool *, void *base, size_t page_cnt,
                        const char *name);
 static bool page_from_pool (const struct pool *, void *page);
+static size_t pool_alloc (struct pool *, size_t page_cnt);
+static size_t buddy_alloc (struct pool *, size_t page_cnt);
+static void buddy_free (struct pool *, size_t page_idx, size_t page_cnt);
 
 /* Initializes the page allocator.  At most USER_PAGE_LIMIT
    pages are put into the user pool. */
@@ -77,9 +114,20 @@ palloc_get_multiple (enum palloc_flags flags, size_t page_cnt)
   if (page_cnt == 0)
     return NULL;
 
-  lock_acquire (&pool->lock);
-  page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
-  lock_release (&pool->lock);
+  page_idx = pool_alloc (pool, page_cnt);
+  if (page_idx == BITMAP_ERROR && pool == &kernel_pool
+      && thread_cache_release () > 0)
+    {
+      /* Exited threads' cached pages were holding kernel memory:
+         try again now that they're back. */
+      page_idx = pool_alloc (pool, page_cnt);
+    }
+  if (page_idx == BITMAP_ERROR)
+    {
+      enum intr_level old_level = intr_disable ();
+      pool->fail_cnt++;
+      intr_set_level (old_level);
+    }
 
   if (page_idx != BITMAP_ERROR)
     pages = pool->base + PGSIZE * page_idx;
@@ -137,8 +185,19 @@ palloc_free_multiple (void *pages, size_t page_cnt)
   memset (pages, 0xcc, PGSIZE * page_cnt);
 #endif
 
-  ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
-  bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+  if (palloc_buddy)
+    {
+      enum intr_level old_level = intr_disable ();
+      ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
+      bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+      buddy_free (pool, page_idx, page_cnt);
+      intr_set_level (old_level);
+    }
+  else
+    {
+      ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
+      bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+    }
 }
 
 /* Frees the page at PAGE. */
@@ -148,15 +207,43 @@ palloc_free_page (void *page)
   palloc_free_multiple (page, 1);
 }
 
+/* Marks PAGE_CNT contiguous free pages in POOL as used and
+   returns the index of the first one, or BITMAP_ERROR if there
+   is no such run. */
+static size_t
+pool_alloc (struct pool *pool, size_t page_cnt)
+{
+  size_t page_idx;
+
+  if (palloc_buddy)
+    {
+      enum intr_level old_level = intr_disable ();
+      page_idx = buddy_alloc (pool, page_cnt);
+      if (page_idx != BITMAP_ERROR)
+        bitmap_set_multiple (pool->used_map, page_idx, page_cnt, true);
+      intr_set_level (old_level);
+    }
+  else
+    {
+      lock_acquire (&pool->lock);
+      page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
+      lock_release (&pool->lock);
+    }
+  return page_idx;
+}
+
 /* Initializes pool P as starting at START and ending at END,
    naming it NAME for debugging purposes. */
 static void
 init_pool (struct pool *p, void *base, size_t page_cnt, const char *name)
 {
-  /* We'll put the pool's used_map at its base.
-     Calculate the space needed for the bitmap
+  /* We'll put the pool's used_map at its base, followed by the
+     buddy system's free_order array if it's in use.
+     Calculate the space needed for them
      and subtract it from the pool's size. */
-  size_t bm_pages = DIV_ROUND_UP (bitmap_buf_size (page_cnt), PGSIZE);
+  size_t bm_size = bitmap_buf_size (page_cnt);
+  size_t order_size = palloc_buddy ? page_cnt : 0;
+  size_t bm_pages = DIV_ROUND_UP (bm_size + order_size, PGSIZE);
   if (bm_pages > page_cnt)
     PANIC ("Not enough memory in %s for bitmap.", name);
   page_cnt -= bm_pages;
@@ -164,9 +251,24 @@ init_pool (struct pool *p, void *base, size_t page_cnt, const char *name)
   printf ("%zu pages available in %s.\n", page_cnt, name);
 
   /* Initialize the pool. */
-  lock_init (&p->lock);
-  p->used_map = bitmap_create_in_buf (page_cnt, base, bm_pages * PGSIZE);
+  lock_init_named (&p->lock, name);
+  p->used_map = bitmap_create_in_buf (page_cnt, base, bm_size);
   p->base = base + bm_pages * PGSIZE;
+  p->name = name;
+  p->fail_cnt = 0;
+
+  /* Put all of the pool on the buddy system's free lists. */
+  if (palloc_buddy)
+    {
+      int order;
+
+      for (order = 0; order < BUDDY_ORDER_CNT; order++)
+        list_init (&p->free_lists[order]);
+      p->free_order = (uint8_t *) base + bm_size;
+      memset (p->free_order, 0, page_cnt);
+      p->free_cnt = 0;
+      buddy_free (p, 0, page_cnt);
+    }
 }
 
 /* Returns true if PAGE was allocated from POOL,
@@ -180,3 +282,157 @@ page_from_pool (const struct pool *pool, void *page)
 
   return page_no >= start_page && page_no < end_page;
 }
+
+/* Returns the free list element stored in page PAGE_IDX of
+   POOL, which must head a free block. */
+static struct list_elem *
+buddy_elem (const struct pool *pool, size_t page_idx)
+{
+  return (struct list_elem *) (pool->base + PGSIZE * page_idx);
+}
+
+/* Returns the index within POOL of the free block whose free list
+   element is ELEM. */
+static size_t
+buddy_index (const struct pool *pool, struct list_elem *elem)
+{
+  return pg_no (elem) - pg_no (pool->base);
+}
+
+/* Puts the free block of 2**ORDER pages at PAGE_IDX on POOL's
+   free list for ORDER, without trying to merge it. */
+static void
+buddy_push (struct pool *pool, size_t page_idx, int order)
+{
+  pool->free_order[page_idx] = order + 1;
+  list_push_front (&pool->free_lists[order], buddy_elem (pool, page_idx));
+}
+
+/* Frees the block of 2**ORDER pages at PAGE_IDX in POOL, merging
+   it with its buddy, and the result with its buddy, and so on, as
+   long as the buddy is free. */
+static void
+buddy_free_block (struct pool *pool, size_t page_idx, int order)
+{
+  size_t page_cnt = bitmap_size (pool->used_map);
+
+  pool->free_cnt += (size_t) 1 << order;
+  while (order < BUDDY_ORDER_CNT - 1)
+    {
+      size_t buddy = page_idx ^ ((size_t) 1 << order);
+      if (buddy + ((size_t) 1 << order) > page_cnt
+          || pool->free_order[buddy] != order + 1)
+        break;
+
+      list_remove (buddy_elem (pool, buddy));
+      pool->free_order[buddy] = 0;
+      if (buddy < page_idx)
+        page_idx = buddy;
+      order++;
+    }
+  buddy_push (pool, page_idx, order);
+}
+
+/* Frees the PAGE_CNT pages at PAGE_IDX in POOL, as the largest
+   aligned blocks that they can be divided into. */
+static void
+buddy_free (struct pool *pool, size_t page_idx, size_t page_cnt)
+{
+  while (page_cnt > 0)
+    {
+      int order = 0;
+
+      while (order < BUDDY_ORDER_CNT - 1
+             && page_idx % ((size_t) 2 << order) == 0
+             && ((size_t) 2 << order) <= page_cnt)
+        order++;
+      buddy_free_block (pool, page_idx, order);
+      page_idx += (size_t) 1 << order;
+      page_cnt -= (size_t) 1 << order;
+    }
+}
+
+/* Allocates PAGE_CNT contiguous pages from POOL and returns the
+   index of the first one, or BITMAP_ERROR if no free block is
+   big enough. */
+static size_t
+buddy_alloc (struct pool *pool, size_t page_cnt)
+{
+  struct list_elem *e;
+  size_t page_idx;
+  int order, i;
+
+  for (order = 0; ((size_t) 1 << order) < page_cnt; order++)
+    if (order == BUDDY_ORDER_CNT - 1)
+      return BITMAP_ERROR;
+
+  /* Take the smallest free block that is big enough... */
+  for (i = order; i < BUDDY_ORDER_CNT; i++)
+    if (!list_empty (&pool->free_lists[i]))
+      break;
+  if (i == BUDDY_ORDER_CNT)
+    return BITMAP_ERROR;
+  e = list_pop_front (&pool->free_lists[i]);
+  page_idx = buddy_index (pool, e);
+  pool->free_order[page_idx] = 0;
+  pool->free_cnt -= (size_t) 1 << i;
+
+  /* ...split it down to 2**ORDER pages, keeping the first half
+     each time... */
+  while (i > order)
+    {
+      i--;
+      buddy_push (pool, page_idx + ((size_t) 1 << i), i);
+      pool->free_cnt += (size_t) 1 << i;
+    }
+
+  /* ...and give back the pages past PAGE_CNT. */
+  buddy_free (pool, page_idx + page_cnt, ((size_t) 1 << order) - page_cnt);
+  return page_idx;
+}
+
+/* Prints POOL's fragmentation statistics.  A pool is
+   "fragmented" to the extent that its free pages are not in its
+   largest free block. */
+static void
+print_pool_stats (struct pool *pool)
+{
+  size_t block_cnt[BUDDY_ORDER_CNT];
+  size_t free_cnt, fail_cnt, largest;
+  enum intr_level old_level;
+  int order;
+
+  /* Take a snapshot, then print it. */
+  old_level = intr_disable ();
+  for (order = 0; order < BUDDY_ORDER_CNT; order++)
+    block_cnt[order] = list_size (&pool->free_lists[order]);
+  free_cnt = pool->free_cnt;
+  fail_cnt = pool->fail_cnt;
+  intr_set_level (old_level);
+
+  largest = 0;
+  for (order = 0; order < BUDDY_ORDER_CNT; order++)
+    if (block_cnt[order] > 0)
+      largest = (size_t) 1 << order;
+
+  printf ("Palloc: %s: %zu of %zu pages free, largest free block %zu, "
+          "%zu%% fragmented, %zu failures\n",
+          pool->name, free_cnt, bitmap_size (pool->used_map), largest,
+          free_cnt > 0 ? 100 - largest * 100 / free_cnt : 0, fail_cnt);
+  printf ("Palloc: %s: free blocks by order:", pool->name);
+  for (order = 0; order < BUDDY_ORDER_CNT; order++)
+    printf (" %zu", block_cnt[order]);
+  printf ("\n");
+}
+
+/* Prints the buddy system's statistics for both pools, if it is
+   in use. */
+void
+palloc_print_stats (void)
+{
+  if (!palloc_buddy)
+    return;
+
+  print_pool_stats (&kernel_pool);
+  print_pool_stats (&user_pool);
+}
@@ -0,0 +1,159 @@
+#include "threads/profile.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "threads/interrupt.h"
+#include "threads/loader.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+#include "devices/timer.h"
+
+/* Pages in the sample buffer. */
+#define PROFILE_PAGES 16
+
+/* One sample: the interrupted EIP, then return addresses from
+   the innermost caller outward, padded with zeros. */
+struct sample
+  {
+    uint32_t pc[1 + PROFILE_DEPTH_MAX];
+  };
+
+/* True if the profiler is on. */
+bool profile_enabled;
+
+/* Return addresses to record per sample. */
+static int depth;
+
+/* Ring buffer of samples.  Once full, new samples overwrite the
+   oldest. */
+static struct sample *samples;
+static size_t sample_max;       /* Capacity. */
+static size_t sample_cnt;       /* Samples in buffer. */
+static size_t sample_next;      /* Where the next sample goes. */
+
+/* Statistics. */
+static long long kernel_cnt;    /* Samples taken in kernel code. */
+static long long user_cnt;      /* Interrupts that hit user code. */
+
+/* Turns on the profiler, recording DEPTH return addresses per
+   sample in addition to the interrupted EIP.  Called while
+   parsing the command line, before profile_init(). */
+void
+profile_configure (int depth_)
+{
+  profile_enabled = true;
+  depth = depth_ < 0 ? 0 : depth_ > PROFILE_DEPTH_MAX ? PROFILE_DEPTH_MAX
+          : depth_;
+}
+
+/* Allocates the sample buffer, if the profiler is on. */
+void
+profile_init (void)
+{
+  if (!profile_enabled)
+    return;
+
+  samples = palloc_get_multiple (PAL_ASSERT, PROFILE_PAGES);
+  sample_max = PROFILE_PAGES * PGSIZE / sizeof *samples;
+  printf ("Profiling at %d Hz, %d caller%s deep, %zu samples kept.\n",
+          TIMER_FREQ * PROFILE_RATE, depth, depth != 1 ? "s" : "",
+          sample_max);
+}
+
+/* Records a sample of the code interrupted by timer interrupt
+   frame F. */
+void
+profile_sample (const struct intr_frame *f)
+{
+  struct sample *s;
+  uintptr_t stack_page;
+  uint32_t *fp;
+  int i;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (samples == NULL)
+    return;
+  if (f->cs != SEL_KCSEG)
+    {
+      user_cnt++;
+      return;
+    }
+  kernel_cnt++;
+
+  s = &samples[sample_next];
+  sample_next = (sample_next + 1) % sample_max;
+  if (sample_cnt < sample_max)
+    sample_cnt++;
+
+  s->pc[0] = (uint32_t) f->eip;
+
+  /* Follow saved frame pointers as long as they stay in the
+     interrupted kernel stack, which is also where F is. */
+  stack_page = (uintptr_t) pg_round_down (f);
+  fp = (uint32_t *) f->ebp;
+  for (i = 1; i <= PROFILE_DEPTH_MAX; i++)
+    {
+      if (i <= depth
+          && (uintptr_t) pg_round_down (fp) == stack_page
+          && (uintptr_t) (fp + 1) < stack_page + PGSIZE)
+        {
+          s->pc[i] = fp[1];
+          fp = (uint32_t *) fp[0];
+        }
+      else
+        s->pc[i] = 0;
+    }
+}
+
+/* Orders samples by call chain, innermost address first. */
+static int
+compare_samples (const void *a_, const void *b_)
+{
+  const struct sample *a = a_;
+  const struct sample *b = b_;
+  int i;
+
+  for (i = 0; i <= PROFILE_DEPTH_MAX; i++)
+    if (a->pc[i] != b->pc[i])
+      return a->pc[i] < b->pc[i] ? -1 : 1;
+  return 0;
+}
+
+/* Prints the samples, one line per distinct call chain with the
+   number of times it was seen.  Pass the output to "backtrace
+   --profile" to get a flat profile. */
+void
+profile_print_stats (void)
+{
+  struct sample *s;
+  enum intr_level old_level;
+  size_t i, j;
+
+  /* Stop sampling, so the buffer holds still. */
+  old_level = intr_disable ();
+  s = samples;
+  samples = NULL;
+  intr_set_level (old_level);
+  if (s == NULL)
+    return;
+
+  printf ("Profile: %lld kernel samples, %lld user, %lld overwritten\n",
+          kernel_cnt, user_cnt, kernel_cnt - (long long) sample_cnt);
+
+  qsort (s, sample_cnt, sizeof *s, compare_samples);
+  for (i = 0; i < sample_cnt; i = j)
+    {
+      int k;
+
+      for (j = i + 1; j < sample_cnt; j++)
+        if (compare_samples (&s[i], &s[j]))
+          break;
+      printf ("Profile: %zu", j - i);
+      for (k = 0; k <= PROFILE_DEPTH_MAX && s[i].pc[k] != 0; k++)
+        printf (" %#"PRIx32, s[i].pc[k]);
+      printf ("\n");
+    }
+}
@@ -0,0 +1,32 @@
+#ifndef THREADS_PROFILE_H
+#define THREADS_PROFILE_H
+
+#include <stdbool.h>
+
+struct intr_frame;
+
+/* Sampling kernel profiler.
+
+   When enabled with the "-profile" option, the timer interrupts
+   PROFILE_RATE times per tick instead of once, and each
+   interrupt that lands in kernel code records the interrupted
+   EIP, and with "-profile=DEPTH" up to DEPTH return addresses
+   from the frame-pointer chain above it, into a ring buffer
+   allocated at boot.  The samples are printed at shutdown, one
+   line per distinct call chain, for "backtrace --profile" to
+   turn into a flat profile. */
+
+/* Samples per timer tick. */
+#define PROFILE_RATE 10
+
+/* Most return addresses recorded per sample. */
+#define PROFILE_DEPTH_MAX 4
+
+extern bool profile_enabled;
+
+void profile_configure (int depth);
+void profile_init (void);
+void profile_sample (const struct intr_frame *);
+void profile_print_stats (void);
+
+#endif /* threads/profile.h */
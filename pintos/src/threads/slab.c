@@ -0,0 +1,208 @@
+#include "threads/slab.h"
+#include <debug.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+/* Each slab is one page.  It begins with a struct slab, followed
+   by the slab's stack of free object indexes, followed by the
+   objects themselves.  Keeping the free objects' links out of the
+   objects leaves constructed objects untouched while they are
+   free. */
+
+/* Magic number for detecting slab corruption. */
+#define SLAB_MAGIC 0x51ab0b1e
+
+/* Alignment of objects. */
+#define SLAB_ALIGN 8
+
+/* Slab header. */
+struct slab
+  {
+    unsigned magic;             /* Always set to SLAB_MAGIC. */
+    struct kmem_cache *cache;   /* Owning cache. */
+    struct list_elem elem;      /* Element in cache's `slabs' list. */
+    size_t free_cnt;            /* Number of free objects. */
+    uint16_t free_idx[];        /* Free objects, top at free_cnt - 1. */
+  };
+
+/* All caches, for statistics. */
+static struct list all_caches = LIST_INITIALIZER (all_caches);
+
+/* Initializes CACHE to hand out objects of SIZE bytes, calling
+   CTOR, if it is nonnull, on each object in every new slab.
+   NAME is used for statistics and must remain valid. */
+void
+kmem_cache_init (struct kmem_cache *cache, const char *name, size_t size,
+                 kmem_ctor_func *ctor)
+{
+  size_t obj_cnt;
+
+  ASSERT (cache != NULL);
+  ASSERT (size > 0);
+
+  cache->name = name;
+  cache->obj_size = ROUND_UP (size, SLAB_ALIGN);
+  cache->ctor = ctor;
+
+  /* Fit as many objects as we can, with their free indexes. */
+  obj_cnt = (PGSIZE - sizeof (struct slab))
+            / (cache->obj_size + sizeof (uint16_t));
+  while (obj_cnt > 0
+         && (ROUND_UP (sizeof (struct slab) + obj_cnt * sizeof (uint16_t),
+                       SLAB_ALIGN)
+             + obj_cnt * cache->obj_size) > PGSIZE)
+    obj_cnt--;
+  ASSERT (obj_cnt > 0);
+  cache->obj_cnt = obj_cnt;
+  cache->obj_ofs = ROUND_UP (sizeof (struct slab)
+                             + obj_cnt * sizeof (uint16_t), SLAB_ALIGN);
+
+  lock_init_named (&cache->lock, name);
+  list_init (&cache->slabs);
+  cache->empty_cnt = 0;
+  cache->slab_cnt = 0;
+  cache->in_use = 0;
+  cache->peak_in_use = 0;
+  cache->alloc_cnt = 0;
+  cache->fail_cnt = 0;
+  list_push_back (&all_caches, &cache->elem);
+}
+
+/* Returns the address of object IDX in slab S. */
+static void *
+slab_obj (struct slab *s, size_t idx)
+{
+  return (uint8_t *) s + s->cache->obj_ofs + idx * s->cache->obj_size;
+}
+
+/* Obtains a page for a new slab in CACHE, constructs its objects,
+   and puts it on CACHE's list of slabs.  Returns the new slab, or
+   a null pointer if no page is available.  CACHE's lock must be
+   held. */
+static struct slab *
+slab_create (struct kmem_cache *cache)
+{
+  struct slab *s;
+  size_t i;
+
+  s = palloc_get_page (0);
+  if (s == NULL)
+    return NULL;
+
+  s->magic = SLAB_MAGIC;
+  s->cache = cache;
+  s->free_cnt = cache->obj_cnt;
+  for (i = 0; i < cache->obj_cnt; i++)
+    {
+      /* Hand out the lowest addresses first. */
+      s->free_idx[i] = cache->obj_cnt - 1 - i;
+      if (cache->ctor != NULL)
+        cache->ctor (slab_obj (s, i));
+    }
+  list_push_front (&cache->slabs, &s->elem);
+  cache->empty_cnt++;
+  cache->slab_cnt++;
+  return s;
+}
+
+/* Obtains and returns an object from CACHE, or a null pointer if
+   memory is not available. */
+void *
+kmem_cache_alloc (struct kmem_cache *cache)
+{
+  struct slab *s;
+  void *obj;
+
+  lock_acquire (&cache->lock);
+  cache->alloc_cnt++;
+  if (list_empty (&cache->slabs))
+    {
+      s = slab_create (cache);
+      if (s == NULL)
+        {
+          cache->fail_cnt++;
+          lock_release (&cache->lock);
+          return NULL;
+        }
+    }
+  else
+    s = list_entry (list_front (&cache->slabs), struct slab, elem);
+
+  if (s->free_cnt == cache->obj_cnt)
+    cache->empty_cnt--;
+  obj = slab_obj (s, s->free_idx[--s->free_cnt]);
+  if (s->free_cnt == 0)
+    list_remove (&s->elem);
+  if (++cache->in_use > cache->peak_in_use)
+    cache->peak_in_use = cache->in_use;
+  lock_release (&cache->lock);
+
+  return obj;
+}
+
+/* Returns OBJ, which must have been obtained from CACHE, to
+   CACHE.  If OBJ is a null pointer, does nothing. */
+void
+kmem_cache_free (struct kmem_cache *cache, void *obj)
+{
+  struct slab *s;
+  size_t ofs;
+
+  if (obj == NULL)
+    return;
+
+  s = pg_round_down (obj);
+  ASSERT (s->magic == SLAB_MAGIC);
+  ASSERT (s->cache == cache);
+  ofs = (uint8_t *) obj - (uint8_t *) s - cache->obj_ofs;
+  ASSERT (ofs % cache->obj_size == 0);
+
+#ifndef NDEBUG
+  /* Clear the object to help detect use-after-free bugs, unless
+     it has to stay constructed. */
+  if (cache->ctor == NULL)
+    memset (obj, 0xcc, cache->obj_size);
+#endif
+
+  lock_acquire (&cache->lock);
+  ASSERT (s->free_cnt < cache->obj_cnt);
+  if (s->free_cnt == 0)
+    list_push_front (&cache->slabs, &s->elem);
+  s->free_idx[s->free_cnt++] = ofs / cache->obj_size;
+  cache->in_use--;
+
+  /* Keep one empty slab on hand; give any others back. */
+  if (s->free_cnt == cache->obj_cnt && ++cache->empty_cnt > 1)
+    {
+      list_remove (&s->elem);
+      cache->empty_cnt--;
+      cache->slab_cnt--;
+      s->magic = 0;
+      palloc_free_page (s);
+    }
+  lock_release (&cache->lock);
+}
+
+/* Prints statistics for each cache that has been used. */
+void
+kmem_cache_print_stats (void)
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&all_caches); e != list_end (&all_caches);
+       e = list_next (e))
+    {
+      struct kmem_cache *c = list_entry (e, struct kmem_cache, elem);
+
+      if (c->alloc_cnt == 0)
+        continue;
+      printf ("Slab: %s: %zu in use (peak %zu), %lld allocations, "
+              "%lld failed, %zu slabs of %zu %zu-byte objects\n",
+              c->name, c->in_use, c->peak_in_use, c->alloc_cnt,
+              c->fail_cnt, c->slab_cnt, c->obj_cnt, c->obj_size);
+    }
+}
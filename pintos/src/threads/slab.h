@@ -0,0 +1,53 @@
+#ifndef THREADS_SLAB_H
+#define THREADS_SLAB_H
+
+#include <list.h>
+#include <stddef.h>
+#include "threads/synch.h"
+
+/* Object caches.
+
+   A kmem_cache hands out objects of a single size, carved out of
+   page-size "slabs" obtained from the page allocator, so that a
+   frequently allocated structure neither pays for malloc()'s
+   rounding up to a power of 2 nor contends on the lock it shares
+   with every other structure of similar size.
+
+   A cache may have a constructor, which is called on each object
+   once, when the slab that holds it is created, rather than on
+   every allocation.  An object must then be freed in the state
+   the constructor left it in, e.g. with any lock it contains
+   released, so that it can be handed out again as is.  Objects
+   from a cache without a constructor are uninitialized. */
+
+/* Initializes object OBJ in a newly created slab. */
+typedef void kmem_ctor_func (void *obj);
+
+/* An object cache. */
+struct kmem_cache
+  {
+    const char *name;           /* Name, for statistics. */
+    size_t obj_size;            /* Bytes per object, rounded up. */
+    size_t obj_cnt;             /* Objects per slab. */
+    size_t obj_ofs;             /* Offset of first object in slab. */
+    kmem_ctor_func *ctor;       /* Constructor, or null. */
+    struct lock lock;           /* Protects all the members below. */
+    struct list slabs;          /* Slabs with at least one free object. */
+    size_t empty_cnt;           /* Slabs in `slabs' with no objects in use. */
+    struct list_elem elem;      /* Element in list of all caches. */
+
+    /* Statistics. */
+    size_t slab_cnt;            /* Slabs allocated. */
+    size_t in_use;              /* Objects allocated. */
+    size_t peak_in_use;         /* Most objects ever allocated at once. */
+    long long alloc_cnt;        /* Calls to kmem_cache_alloc(). */
+    long long fail_cnt;         /* Allocations that failed. */
+  };
+
+void kmem_cache_init (struct kmem_cache *, const char *name, size_t size,
+                      kmem_ctor_func *);
+void *kmem_cache_alloc (struct kmem_cache *);
+void kmem_cache_free (struct kmem_cache *, void *);
+void kmem_cache_print_stats (void);
+
+#endif /* threads/slab.h */
@@ -31,6 +31,19 @@
 #include <string.h>
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "devices/timer.h"
+
+/* If true, semaphores and locks given names keep contention
+   statistics.  Controlled by kernel command-line option
+   "-lockstat". */
+bool lock_stats_enabled;
+
+/* Statistics for each distinct name, in order of first use. */
+#define LOCK_STATS_MAX 32
+static struct lock_stats lock_stats[LOCK_STATS_MAX];
+static int lock_stats_cnt;
+
+static struct lock_stats *lock_stats_lookup (const char *name);
 
 /* Initializes semaphore SEMA to VALUE.  A semaphore is a
    nonnegative integer along with two atomic operators for
@@ -48,6 +61,17 @@ sema_init (struct semaphore *sema, unsigned value)
 
   sema->value = value;
   list_init (&sema->waiters);
+  sema->stats = NULL;
+}
+
+/* Initializes semaphore SEMA to VALUE, like sema_init(), and
+   counts its contention under NAME, together with every other
+   semaphore or lock of that name. */
+void
+sema_init_named (struct semaphore *sema, unsigned value, const char *name)
+{
+  sema_init (sema, value);
+  sema->stats = lock_stats_lookup (name);
 }
 
 /* Down or "P" operation on a semaphore.  Waits for SEMA's value
@@ -60,18 +84,39 @@ sema_init (struct semaphore *sema, unsigned value)
 void
 sema_down (struct semaphore *sema)
 {
+  struct lock_stats *stats;
   enum intr_level old_level;
+  bool contended = false;
+  int64_t start = 0;
 
   ASSERT (sema != NULL);
   ASSERT (!intr_context ());
 
+  stats = lock_stats_enabled ? sema->stats : NULL;
   old_level = intr_disable ();
+  if (stats != NULL && sema->value == 0)
+    {
+      contended = true;
+      start = timer_usecs ();
+    }
   while (sema->value == 0)
     {
       list_push_back (&sema->waiters, &thread_current ()->elem);
       thread_block ();
     }
   sema->value--;
+  if (stats != NULL)
+    {
+      stats->acquire_cnt++;
+      if (contended)
+        {
+          int64_t wait = timer_usecs () - start;
+          stats->contended_cnt++;
+          stats->wait_us += wait;
+          if (wait > stats->max_wait_us)
+            stats->max_wait_us = wait;
+        }
+    }
   intr_set_level (old_level);
 }
 
@@ -93,6 +138,8 @@ sema_try_down (struct semaphore *sema)
     {
       sema->value--;
       success = true;
+      if (lock_stats_enabled && sema->stats != NULL)
+        sema->stats->acquire_cnt++;
     }
   else
     success = false;
@@ -181,6 +228,18 @@ lock_init (struct lock *lock)
   sema_init (&lock->semaphore, 1);
 }
 
+/* Initializes LOCK, like lock_init(), and counts its contention
+   and hold times under NAME, together with every other lock of
+   that name. */
+void
+lock_init_named (struct lock *lock, const char *name)
+{
+  ASSERT (lock != NULL);
+
+  lock->holder = NULL;
+  sema_init_named (&lock->semaphore, 1, name);
+}
+
 /* Acquires LOCK, sleeping until it becomes available if
    necessary.  The lock must not already be held by the current
    thread.
@@ -198,6 +257,8 @@ lock_acquire (struct lock *lock)
 
   sema_down (&lock->semaphore);
   lock->holder = thread_current ();
+  if (lock_stats_enabled && lock->semaphore.stats != NULL)
+    lock->acquire_time = timer_usecs ();
 }
 
 /* Tries to acquires LOCK and returns true if successful or false
@@ -216,7 +277,11 @@ lock_try_acquire (struct lock *lock)
 
   success = sema_try_down (&lock->semaphore);
   if (success)
-    lock->holder = thread_current ();
+    {
+      lock->holder = thread_current ();
+      if (lock_stats_enabled && lock->semaphore.stats != NULL)
+        lock->acquire_time = timer_usecs ();
+    }
   return success;
 }
 
@@ -231,6 +296,16 @@ lock_release (struct lock *lock)
   ASSERT (lock != NULL);
   ASSERT (lock_held_by_current_thread (lock));
 
+  if (lock_stats_enabled && lock->semaphore.stats != NULL)
+    {
+      struct lock_stats *stats = lock->semaphore.stats;
+      int64_t hold = timer_usecs () - lock->acquire_time;
+      enum intr_level old_level = intr_disable ();
+      if (hold > stats->max_hold_us)
+        stats->max_hold_us = hold;
+      intr_set_level (old_level);
+    }
+
   lock->holder = NULL;
   sema_up (&lock->semaphore);
 }
@@ -246,6 +321,68 @@ lock_held_by_current_thread (const struct lock *lock)
   return lock->holder == thread_current ();
 }
 
+/* Returns the statistics kept under NAME, which must remain
+   valid, creating them if this is the first use of NAME, or a
+   null pointer if there is no room for more names. */
+static struct lock_stats *
+lock_stats_lookup (const char *name)
+{
+  struct lock_stats *s;
+  enum intr_level old_level;
+
+  ASSERT (name != NULL);
+
+  old_level = intr_disable ();
+  for (s = lock_stats; s < lock_stats + lock_stats_cnt; s++)
+    if (!strcmp (s->name, name))
+      break;
+  if (s == lock_stats + lock_stats_cnt)
+    {
+      if (lock_stats_cnt < LOCK_STATS_MAX)
+        {
+          s->name = name;
+          lock_stats_cnt++;
+        }
+      else
+        s = NULL;
+    }
+  intr_set_level (old_level);
+  return s;
+}
+
+/* Prints the statistics of every named semaphore and lock that
+   was ever acquired, those that waited longest in total first. */
+void
+lock_print_stats (void)
+{
+  struct lock_stats *sorted[LOCK_STATS_MAX];
+  int cnt = lock_stats_cnt;
+  int i, j;
+
+  if (!lock_stats_enabled)
+    return;
+
+  /* Insertion sort by descending total wait. */
+  for (i = 0; i < cnt; i++)
+    {
+      for (j = i; j > 0 && sorted[j - 1]->wait_us < lock_stats[i].wait_us; j--)
+        sorted[j] = sorted[j - 1];
+      sorted[j] = &lock_stats[i];
+    }
+
+  printf ("Locks: %-20s %10s %10s %12s %10s %10s\n", "name", "acquires",
+          "contended", "wait us", "max wait", "max hold");
+  for (i = 0; i < cnt; i++)
+    {
+      struct lock_stats *s = sorted[i];
+      if (s->acquire_cnt == 0)
+        continue;
+      printf ("Locks: %-20s %10llu %10llu %12lld %10lld %10lld\n", s->name,
+              s->acquire_cnt, s->contended_cnt, s->wait_us, s->max_wait_us,
+              s->max_hold_us);
+    }
+}
+
 /* One semaphore in a list. */
 struct semaphore_elem
   {
@@ -3,15 +3,34 @@
 
 #include <list.h>
 #include <stdbool.h>
+#include <stdint.h>
+
+/* Contention statistics, shared by every semaphore or lock
+   initialized with the same name by sema_init_named() or
+   lock_init_named().  Kept only when lock_stats_enabled, which
+   the "-lockstat" option sets. */
+struct lock_stats
+  {
+    const char *name;           /* Name given at initialization. */
+    uint64_t acquire_cnt;       /* Downs or acquires. */
+    uint64_t contended_cnt;     /* Those that had to wait. */
+    int64_t wait_us;            /* Total time spent waiting. */
+    int64_t max_wait_us;        /* Longest single wait. */
+    int64_t max_hold_us;        /* Longest a lock was held. */
+  };
+
+extern bool lock_stats_enabled;
 
 /* A counting semaphore. */
 struct semaphore
   {
     unsigned value;             /* Current value. */
     struct list waiters;        /* List of waiting threads. */
+    struct lock_stats *stats;   /* Contention statistics, or null. */
   };
 
 void sema_init (struct semaphore *, unsigned value);
+void sema_init_named (struct semaphore *, unsigned value, const char *name);
 void sema_down (struct semaphore *);
 bool sema_try_down (struct semaphore *);
 void sema_up (struct semaphore *);
@@ -22,13 +41,17 @@ struct lock
   {
     struct thread *holder;      /* Thread holding lock (for debugging). */
     struct semaphore semaphore; /* Binary semaphore controlling access. */
+    int64_t acquire_time;       /* timer_usecs() when acquired, if the
+                                   semaphore keeps statistics. */
   };
 
 void lock_init (struct lock *);
+void lock_init_named (struct lock *, const char *name);
 void lock_acquire (struct lock *);
 bool lock_try_acquire (struct lock *);
 void lock_release (struct lock *);
 bool lock_held_by_current_thread (const struct lock *);
+void lock_print_stats (void);
 
 /* Condition variable. */
 struct condition
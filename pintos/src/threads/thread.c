@@ -10,10 +10,11 @@
 #include "threads/palloc.h"
 #include "threads/switch.h"
 #include "threads/synch.h"
+#include "threads/trace.h"
 #include "threads/vaddr.h"
 #ifdef USERPROG
 #include "userprog/process.h"
-#include "threads/malloc.h"
+#include "threads/slab.h"
 #endif
 
 /* Random value for struct thread's `magic' member.
@@ -21,12 +22,6 @@
    of thread.h for details. */
 #define THREAD_MAGIC 0xcd6abf4b
 
-#ifdef USERPROG
-/* use synchronization to ensure that only one process
-   at a time is executing file system code */
-static struct lock fsys_lock;
-#endif
-
 /* List of processes in THREAD_READY state, that is, processes
    that are ready to run but not actually running. */
 static struct list ready_list;
@@ -41,8 +36,22 @@ static struct thread *idle_thread;
 /* Initial thread, the thread running init.c:main(). */
 static struct thread *initial_thread;
 
-/* Lock used by allocate_tid(). */
-static struct lock tid_lock;
+/* Pages of exited threads, kept for thread_create() to reuse
+   without going back to the page allocator.  A recycled page is
+   not zeroed: init_thread() clears the struct thread at its
+   bottom, and the stack above is written before it is read.
+   thread_cache_release() gives them back when memory runs low. */
+#define THREAD_CACHE_MAX 16
+static struct thread *thread_cache[THREAD_CACHE_MAX];
+static int thread_cache_cnt;
+
+#ifdef USERPROG
+/* Caches of struct wait_status and struct process_file_map_elem. */
+static struct kmem_cache wait_status_cache;
+static struct kmem_cache pfme_cache;
+
+static void wait_status_ctor (void *);
+#endif
 
 /* Stack frame for kernel_thread(). */
 struct kernel_thread_frame
@@ -83,7 +92,7 @@ static tid_t allocate_tid (void);
    general and it is possible in this case only because loader.S
    was careful to put the bottom of the stack at a page boundary.
 
-   Also initializes the run queue and the tid lock.
+   Also initializes the run queue.
 
    After calling this function, be sure to initialize the page
    allocator before trying to create any threads with
@@ -96,12 +105,14 @@ thread_init (void)
 {
   ASSERT (intr_get_level () == INTR_OFF);
 
-  lock_init (&tid_lock);
   list_init (&ready_list);
   list_init (&all_list);
-  #ifdef USERPROG
-  lock_init(&fsys_lock);
-  #endif
+#ifdef USERPROG
+  kmem_cache_init (&wait_status_cache, "wait_status",
+                   sizeof (struct wait_status), wait_status_ctor);
+  kmem_cache_init (&pfme_cache, "process_file_map_elem",
+                   sizeof (struct process_file_map_elem), NULL);
+#endif
 
   /* Set up a thread structure for the running thread. */
   initial_thread = running_thread ();
@@ -180,18 +191,24 @@ thread_create (const char *name, int priority,
   struct kernel_thread_frame *kf;
   struct switch_entry_frame *ef;
   struct switch_threads_frame *sf;
+  enum intr_level old_level;
   tid_t tid;
 
   ASSERT (function != NULL);
 
-  /* Allocate thread. */
-  t = palloc_get_page (PAL_ZERO);
+  /* Allocate thread, preferably recycling an exited one's page. */
+  old_level = intr_disable ();
+  t = thread_cache_cnt > 0 ? thread_cache[--thread_cache_cnt] : NULL;
+  intr_set_level (old_level);
+  if (t == NULL)
+    t = palloc_get_page (PAL_ZERO);
   if (t == NULL)
     return TID_ERROR;
 
   /* Initialize thread. */
   init_thread (t, name, priority);
   tid = t->tid = allocate_tid ();
+  TRACE (TRACE_THREAD, tid, trace_pack (t->name, 0), trace_pack (t->name, 1));
 
   /* Stack frame for kernel_thread(). */
   kf = alloc_frame (t, sizeof *kf);
@@ -496,7 +513,6 @@ init_thread (struct thread *t, const char *name, int priority)
   list_init(&t->children);
   list_init(&t->process_file_map);
   t->next_fd = 2;
-  t->holding_filesys_lock = false;
   #endif
 #ifdef FILESYS
   t->cwd = NULL;
@@ -573,7 +589,36 @@ thread_schedule_tail (struct thread *prev)
   if (prev != NULL && prev->status == THREAD_DYING && prev != initial_thread)
     {
       ASSERT (prev != cur);
-      palloc_free_page (prev);
+      if (thread_cache_cnt < THREAD_CACHE_MAX)
+        {
+          /* Stale pointers to PREV must not pass is_thread(). */
+          prev->magic = 0;
+          thread_cache[thread_cache_cnt++] = prev;
+        }
+      else
+        palloc_free_page (prev);
+    }
+}
+
+/* Gives the pages that exited threads left for thread_create()
+   to reuse back to the page allocator.  Called by the page
+   allocator when the kernel pool runs out.  Returns the number
+   of pages given back. */
+size_t
+thread_cache_release (void)
+{
+  size_t cnt = 0;
+
+  for (;;)
+    {
+      enum intr_level old_level = intr_disable ();
+      struct thread *t = (thread_cache_cnt > 0
+                          ? thread_cache[--thread_cache_cnt] : NULL);
+      intr_set_level (old_level);
+      if (t == NULL)
+        return cnt;
+      palloc_free_page (t);
+      cnt++;
     }
 }
 
@@ -596,7 +641,10 @@ schedule (void)
   ASSERT (is_thread (next));
 
   if (cur != next)
-    prev = switch_threads (cur, next);
+    {
+      TRACE (TRACE_SWITCH, next->tid, cur->status, 0);
+      prev = switch_threads (cur, next);
+    }
   thread_schedule_tail (prev);
 }
 
@@ -605,11 +653,14 @@ static tid_t
 allocate_tid (void)
 {
   static tid_t next_tid = 1;
+  enum intr_level old_level;
   tid_t tid;
 
-  lock_acquire (&tid_lock);
+  /* Far too short a critical section to be worth a lock, which
+     would cost two semaphore operations per thread created. */
+  old_level = intr_disable ();
   tid = next_tid++;
-  lock_release (&tid_lock);
+  intr_set_level (old_level);
 
   return tid;
 }
@@ -623,15 +674,29 @@ int get_all_list_size(void)
 {
   return list_size(&all_list);
 }
+/* Constructs a wait_status in wait_status_cache.  The lock is
+   only initialized here, so whoever frees a wait_status must
+   first make sure nobody holds or waits for it: process_wait()
+   takes it after the child's sema_up() for that reason. */
+static void wait_status_ctor(void *ws_)
+{
+  struct wait_status *ws = ws_;
+  lock_init_named(&ws->lock, "wait_status lock");
+}
+
+void free_wait_status(struct wait_status *ws)
+{
+  kmem_cache_free(&wait_status_cache, ws);
+}
+
 void init_wait_status(struct thread *t)
 {
   /* main and idle thread don't need these things */
   if (get_all_list_size() == 3) //main is creating the first proc
   { 
-    t->wait_status = malloc(sizeof(struct wait_status));
+    t->wait_status = kmem_cache_alloc(&wait_status_cache);
     sema_init(&t->wait_status->dead, 0);
     sema_init(&t->wait_status->wait_load, 0);
-    lock_init(&t->wait_status->lock);
     list_push_back(&thread_current()->children, &t->wait_status->elem);
     t->wait_status->exit_code = -1;
     lock_acquire(&t->wait_status->lock);
@@ -642,10 +707,9 @@ void init_wait_status(struct thread *t)
   }
   if (get_all_list_size() > 3) //proc is creating other proc
   {
-    t->wait_status = malloc(sizeof(struct wait_status));
+    t->wait_status = kmem_cache_alloc(&wait_status_cache);
     sema_init(&t->wait_status->dead, 0);
     sema_init(&t->wait_status->wait_load, 0);
-    lock_init(&t->wait_status->lock);
     list_push_back(&thread_current()->children, &t->wait_status->elem);
     t->wait_status->exit_code = -1;
     lock_acquire(&t->wait_status->lock);
@@ -674,7 +738,7 @@ struct wait_status *get_tid_wait_status(tid_t tid)
 struct process_file_map_elem* create_pfme(struct file* f) {
     int next = thread_current()->next_fd;
     if (true) {
-        struct process_file_map_elem* pfme = malloc(sizeof(struct process_file_map_elem));
+        struct process_file_map_elem* pfme = kmem_cache_alloc(&pfme_cache);
         if (pfme != NULL) {
             pfme->fd = next;
             pfme->file = f;
@@ -713,7 +777,7 @@ void remove_pfme_by_fd (int fd) {
     }
     if (what_to_remove_pfme != NULL) {
         list_remove(what_to_remove_le);
-        free(what_to_remove_pfme);
+        kmem_cache_free(&pfme_cache, what_to_remove_pfme);
         //Now, we shift all file descriptors down and decrement the value of next_fd
         /*for (iterator = list_begin(&thread_current()->process_file_map); iterator != list_end(&thread_current()->process_file_map); iterator = list_next(iterator)) {
             struct process_file_map_elem* pfme = list_entry(iterator, struct process_file_map_elem, elem);
@@ -727,34 +791,13 @@ void remove_pfme_by_fd (int fd) {
 
 //Called upon process exiting/termination
 void close_all_fd (void) {
-    filesys_lock_acuqire();
     while (!list_empty(&thread_current()->process_file_map)) {
         struct list_elem* popped = list_pop_front(&thread_current()->process_file_map);
         struct process_file_map_elem* popped_pfme = list_entry(popped, struct process_file_map_elem, elem);
         file_allow_write(popped_pfme->file);
         file_close(popped_pfme->file);
-        free(popped_pfme);
+        kmem_cache_free(&pfme_cache, popped_pfme);
     }
-    filesys_lock_release();
-}
-
-void filesys_lock_acuqire(void)
-{
-  thread_current()->holding_filesys_lock = true;
-  if (lock_held_by_current_thread(&fsys_lock))
-  {
-    return;
-  }
-  lock_acquire(&fsys_lock);
-}
-void filesys_lock_release(void)
-{
-  thread_current()->holding_filesys_lock = false;
-  if (!lock_held_by_current_thread(&fsys_lock))
-  {
-    return;
-  }
-  lock_release(&fsys_lock);
 }
 
 #endif
@@ -34,6 +34,7 @@ typedef int tid_t;
 #define MAX_FD_NUM 126
 struct wait_status *get_tid_wait_status(tid_t tid);
 void init_wait_status(struct thread *t);
+void free_wait_status(struct wait_status *ws);
 int get_all_list_size(void);
 struct wait_status
 {
@@ -53,8 +54,6 @@ void push_back_pfme (struct process_file_map_elem* pfme); /*Appends the provided
 void create_and_push_back_pfme(struct file* f); /*Combination of the two methods above executed in sequence*/
 void remove_pfme_by_fd(int fd); //Used by close syscall on a particular fd
 void close_all_fd(void); //Closes all file descriptors on the current process
-void filesys_lock_acuqire(void);
-void filesys_lock_release(void);
 
 struct process_file_map_elem {
     int fd;
@@ -140,7 +139,6 @@ struct thread
     struct list process_file_map; /* List of process_file_map_elem that deals with maps file descriptors to file structs */
     int next_fd; /*Next file descriptor value to use upon successful syscall to open; ranges from 2 to 128, inclusive*/
     //NOTE: next_fd will only be updated on the first call to a file's open, unless that file has been removed
-    bool holding_filesys_lock;
 #endif
     
 #ifdef FILESYS
@@ -164,6 +162,7 @@ void thread_print_stats (void);
 
 typedef void thread_func (void *aux);
 tid_t thread_create (const char *name, int priority, thread_func *, void *);
+size_t thread_cache_release (void);
 
 void thread_block (void);
 void thread_unblock (struct thread *);
@@ -0,0 +1,117 @@
+#include "threads/trace.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/thread.h"
+#include "threads/tsc.h"
+#include "threads/vaddr.h"
+#include "devices/timer.h"
+
+/* Pages in the trace buffer. */
+#define TRACE_PAGES 32
+
+/* One trace record, 24 bytes. */
+struct trace_rec
+  {
+    uint64_t tsc;               /* Time-stamp counter. */
+    uint16_t tid;               /* Running thread. */
+    uint16_t event;             /* A TRACE_* event. */
+    uint32_t arg[3];            /* Event-specific arguments. */
+  };
+
+/* True if tracing is on. */
+bool trace_enabled;
+
+/* Ring buffer of records.  Once full, new records overwrite the
+   oldest. */
+static struct trace_rec *recs;
+static size_t rec_max;          /* Capacity. */
+static size_t rec_cnt;          /* Records in buffer. */
+static size_t rec_next;         /* Where the next record goes. */
+static long long rec_total;     /* Records ever written. */
+
+/* Time-stamp counter and timer_usecs() when tracing began, to
+   convert cycles to time at shutdown. */
+static uint64_t start_tsc;
+static int64_t start_usecs;
+
+/* Allocates the trace buffer, if tracing is on. */
+void
+trace_init (void)
+{
+  if (!trace_enabled)
+    return;
+
+  recs = palloc_get_multiple (PAL_ASSERT, TRACE_PAGES);
+  rec_max = TRACE_PAGES * PGSIZE / sizeof *recs;
+  start_usecs = timer_usecs ();
+  start_tsc = rdtsc ();
+  printf ("Tracing, %zu records kept.\n", rec_max);
+
+  /* Name the thread that is already running. */
+  TRACE (TRACE_THREAD, thread_current ()->tid,
+         trace_pack (thread_name (), 0), trace_pack (thread_name (), 1));
+}
+
+/* Appends a record of EVENT with arguments A0, A1, and A2.  Use
+   the TRACE macro instead of calling this directly. */
+void
+trace_record (enum trace_event event, uint32_t a0, uint32_t a1, uint32_t a2)
+{
+  struct trace_rec *r;
+  enum intr_level old_level;
+
+  old_level = intr_disable ();
+  if (recs != NULL)
+    {
+      r = &recs[rec_next];
+      rec_next = (rec_next + 1) % rec_max;
+      if (rec_cnt < rec_max)
+        rec_cnt++;
+      rec_total++;
+
+      r->tsc = rdtsc ();
+      r->tid = thread_current ()->tid;
+      r->event = event;
+      r->arg[0] = a0;
+      r->arg[1] = a1;
+      r->arg[2] = a2;
+    }
+  intr_set_level (old_level);
+}
+
+/* Prints the trace buffer, oldest record first, one line per
+   record.  Pass the output to "trace-timeline" to decode it. */
+void
+trace_print_stats (void)
+{
+  struct trace_rec *r;
+  enum intr_level old_level;
+  uint64_t cycles;
+  int64_t usecs;
+  size_t i;
+
+  /* Stop tracing, so the buffer holds still. */
+  old_level = intr_disable ();
+  r = recs;
+  recs = NULL;
+  intr_set_level (old_level);
+  if (r == NULL)
+    return;
+
+  cycles = rdtsc () - start_tsc;
+  usecs = timer_usecs () - start_usecs;
+  printf ("Trace: %zu records, %lld overwritten, %"PRIu64" cycles/ms\n",
+          rec_cnt, rec_total - (long long) rec_cnt,
+          usecs > 0 ? cycles * 1000 / usecs : 0);
+  for (i = 0; i < rec_cnt; i++)
+    {
+      const struct trace_rec *t = &r[(rec_next + rec_max - rec_cnt + i)
+                                     % rec_max];
+      printf ("Trace: %"PRIx64" %"PRIu16" %"PRIu16
+              " %"PRIx32" %"PRIx32" %"PRIx32"\n",
+              t->tsc, t->tid, t->event, t->arg[0], t->arg[1], t->arg[2]);
+    }
+}
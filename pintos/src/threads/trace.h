@@ -0,0 +1,73 @@
+#ifndef THREADS_TRACE_H
+#define THREADS_TRACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Static kernel tracepoints.
+
+   A tracepoint is a TRACE() call naming one of the events below
+   and up to three 32-bit arguments.  When tracing is on, with the
+   "-trace" option, each tracepoint that is reached appends a
+   fixed-size binary record -- time-stamp counter, current
+   thread, event, arguments -- to a ring buffer allocated at boot.
+   The buffer is printed over the console at shutdown, for
+   "trace-timeline" in utils/ to decode.
+
+   Only events whose bits are set in TRACE_MASK are compiled in;
+   the others cost nothing, not even the test of trace_enabled.
+   Build with, e.g., CFLAGS += -DTRACE_MASK=0 to drop them all. */
+
+/* Event IDs.  The decoder knows these by number, so append new
+   events at the end. */
+enum trace_event
+  {
+    TRACE_SWITCH,         /* Context switch: next tid, old status. */
+    TRACE_THREAD,         /* Thread created: tid, first 8 name bytes. */
+    TRACE_SYSCALL,        /* System call entry: number. */
+    TRACE_SYSCALL_RET,    /* System call return: number, eax. */
+    TRACE_CACHE_MISS,     /* Buffer cache miss: sector, write, evicted. */
+    TRACE_BLOCK_START,    /* Block I/O start: sector, count, write. */
+    TRACE_BLOCK_DONE,     /* Block I/O done: sector, count, write. */
+    TRACE_EVENT_CNT
+  };
+
+/* Events compiled in, one bit per event. */
+#ifndef TRACE_MASK
+#define TRACE_MASK ((1u << TRACE_EVENT_CNT) - 1)
+#endif
+
+/* Records EVENT with arguments A0, A1, and A2, if EVENT is
+   compiled in and tracing is on. */
+#define TRACE(EVENT, A0, A1, A2)                                        \
+        do                                                              \
+          {                                                             \
+            if ((TRACE_MASK & (1u << (EVENT))) && trace_enabled)        \
+              trace_record ((EVENT), (uint32_t) (A0), (uint32_t) (A1),  \
+                            (uint32_t) (A2));                           \
+          }                                                             \
+        while (0)
+
+extern bool trace_enabled;
+
+/* Returns bytes 4*WORD through 4*WORD + 3 of null-terminated
+   string S, packed little-endian and padded with zeros, for
+   passing a short name to TRACE(). */
+static inline uint32_t
+trace_pack (const char *s, int word)
+{
+  uint32_t w = 0;
+  int i;
+
+  for (i = 0; i < 4 * word && *s != '\0'; i++)
+    s++;
+  for (i = 0; i < 4 && *s != '\0'; i++)
+    w |= (uint32_t) (uint8_t) *s++ << (8 * i);
+  return w;
+}
+
+void trace_init (void);
+void trace_record (enum trace_event, uint32_t, uint32_t, uint32_t);
+void trace_print_stats (void);
+
+#endif /* threads/trace.h */
@@ -139,9 +139,12 @@ process_wait (tid_t child_tid UNUSED)
   else
   {
     sema_down(&tid_wait_status->dead);
+    //The child ups dead while holding the lock, so wait for it to let go before freeing
+    lock_acquire(&tid_wait_status->lock);
     tid_exit_code = tid_wait_status->exit_code;
+    lock_release(&tid_wait_status->lock);
     list_remove(&tid_wait_status->elem);
-    free(tid_wait_status);
+    free_wait_status(tid_wait_status);
     return tid_exit_code;
   }
 }
@@ -158,10 +161,6 @@ process_exit (void)
   pd = cur->pagedir;
   //Clean up malloc'ed memory for process file map elements, and also allow writes again
   close_all_fd();
-  if (cur->holding_filesys_lock == true)
-  {
-    filesys_lock_release();
-  }
 
   if (pd != NULL)
     {
@@ -189,7 +188,7 @@ process_exit (void)
     if (cur->wait_status->parent_alive == 0)
     {
       lock_release(&cur->wait_status->lock);
-      free(cur->wait_status);
+      free_wait_status(cur->wait_status);
     }
     else
     {
@@ -204,7 +203,7 @@ process_exit (void)
       if (ws->me_alive == 0)
       {
         lock_release(&ws->lock);
-        free(ws);
+        free_wait_status(ws);
       }
       else
       {
@@ -6,6 +6,7 @@
 #include <syscall-nr.h>
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "threads/trace.h"
 #include "threads/vaddr.h"
 #include "threads/malloc.h"
 #include "devices/shutdown.h"
@@ -45,6 +46,11 @@ static bool proc_cache_hit(void);
 static void proc_cache_reset(void);
 
 static int proc_get_write_cnt(void);
+
+static bool proc_fsync(int fd);
+static void proc_sync(void);
+
+static void proc_block_stats(struct block_stats *stats);
 //int isdir_count;
 
 void
@@ -60,6 +66,8 @@ syscall_handler (struct intr_frame *f UNUSED)
   uint32_t* args = ((uint32_t*) f->esp);
   access_user_memory(args, f);
   //printf("System call number: %d\n", args[0]);
+  //Only the number is traced: the arguments have not been checked yet
+  TRACE(TRACE_SYSCALL, args[0], 0, 0);
 
   if (args[0] == SYS_PRACTICE)
   {
@@ -169,6 +177,20 @@ syscall_handler (struct intr_frame *f UNUSED)
   else if (args[0] == SYS_WRITE_CNT) {
     f->eax = proc_get_write_cnt();
   }
+  else if (args[0] == SYS_FSYNC) {
+    access_user_memory(args+1, f);
+    f->eax = (int) proc_fsync(args[1]);
+  }
+  else if (args[0] == SYS_SYNC) {
+    proc_sync();
+  }
+  else if (args[0] == SYS_BLOCK_STATS) {
+    access_user_memory(args+1, f);
+    access_user_memory((uint32_t*) *(args+1), f);
+    access_user_memory((uint32_t*) ((struct block_stats *) *(args+1) + 1) - 1, f);
+    proc_block_stats((struct block_stats *) args[1]);
+  }
+  TRACE(TRACE_SYSCALL_RET, args[0], f->eax, 0);
 }
 
 static void access_user_memory(uint32_t* vaddr, struct intr_frame *f)
@@ -466,3 +488,23 @@ static void proc_cache_reset(void) {
 static int proc_get_write_cnt(void) {
     return get_num_writes(fs_device);
 }
+
+static bool proc_fsync(int fd) {
+  struct list_elem* index;
+  for (index = list_begin(&thread_current()->process_file_map); index != list_end(&thread_current()->process_file_map); index = list_next(index)) {
+    struct process_file_map_elem* pfme = list_entry(index, struct process_file_map_elem, elem);
+    if (pfme->fd == fd) {
+      inode_flush(file_get_inode(pfme->file));
+      return true;
+    }
+  }
+  return false;
+}
+
+static void proc_sync(void) {
+    cache_sync();
+}
+
+static void proc_block_stats(struct block_stats *stats) {
+    block_get_stats(fs_device, stats);
+}
@@ -0,0 +1,209 @@
+#include "devices/timeout.h"
+#include <debug.h>
+#include <stdint.h>
+#include "threads/interrupt.h"
+
+/* The wheel has WHEEL_LEVELS levels of WHEEL_SIZE slots each.
+   A slot at level L covers WHEEL_SIZE**L ticks, so level 0 holds
+   timeouts due within the next WHEEL_SIZE ticks, level 1 those
+   due within WHEEL_SIZE**2 ticks, and so on.  Each time level L
+   wraps around, the next slot of level L + 1 is "cascaded": its
+   timeouts are redistributed over the levels below.
+
+   With 4 levels of 64 slots the wheel spans 2**24 ticks, about
+   46 hours at 100 Hz.  Timeouts further out than that are parked
+   in the last slot of the top level and re-filed from there. */
+#define WHEEL_BITS 6
+#define WHEEL_SIZE (1 << WHEEL_BITS)
+#define WHEEL_MASK (WHEEL_SIZE - 1)
+#define WHEEL_LEVELS 4
+#define WHEEL_SPAN ((int64_t) 1 << (WHEEL_BITS * WHEEL_LEVELS))
+
+static struct list wheel[WHEEL_LEVELS][WHEEL_SIZE];
+
+/* Next tick not yet processed by timeout_run(). */
+static int64_t wheel_clock;
+
+/* Number of pending timeouts. */
+static int pending_cnt;
+
+/* Returns the index of the slot at LEVEL that covers tick T. */
+static inline int
+slot_index (int64_t t, int level)
+{
+  return (t >> (WHEEL_BITS * level)) & WHEEL_MASK;
+}
+
+/* Puts T into the slot that covers its expiration time.
+   Interrupts must be off. */
+static void
+file_timeout (struct timeout *t)
+{
+  int64_t delta = t->expires - wheel_clock;
+  int level;
+
+  if (delta < 0)
+    {
+      /* Already due: expire on the next tick processed. */
+      list_push_back (&wheel[0][slot_index (wheel_clock, 0)], &t->elem);
+      return;
+    }
+  if (delta >= WHEEL_SPAN)
+    {
+      /* Too far out: park it at the top level's horizon. */
+      int64_t horizon = wheel_clock + WHEEL_SPAN - 1;
+      list_push_back (&wheel[WHEEL_LEVELS - 1]
+                      [slot_index (horizon, WHEEL_LEVELS - 1)], &t->elem);
+      return;
+    }
+
+  for (level = 0; level < WHEEL_LEVELS - 1; level++)
+    if (delta < (int64_t) 1 << (WHEEL_BITS * (level + 1)))
+      break;
+  list_push_back (&wheel[level][slot_index (t->expires, level)], &t->elem);
+}
+
+/* Re-files every timeout in the current slot of LEVEL into the
+   levels below.  Returns that slot's index, so the caller can
+   tell whether LEVEL itself just wrapped around. */
+static int
+cascade (int level)
+{
+  int idx = slot_index (wheel_clock, level);
+  struct list *slot = &wheel[level][idx];
+  struct list moved;
+
+  list_init (&moved);
+  while (!list_empty (slot))
+    list_push_back (&moved, list_pop_front (slot));
+  while (!list_empty (&moved))
+    file_timeout (list_entry (list_pop_front (&moved),
+                              struct timeout, elem));
+  return idx;
+}
+
+/* Initializes the timer wheel. */
+void
+timeout_init (void)
+{
+  int level, i;
+
+  for (level = 0; level < WHEEL_LEVELS; level++)
+    for (i = 0; i < WHEEL_SIZE; i++)
+      list_init (&wheel[level][i]);
+  wheel_clock = 0;
+  pending_cnt = 0;
+}
+
+/* Arranges for FUNC to be called with T and AUX from the timer
+   interrupt once timer_ticks() reaches EXPIRES.  If EXPIRES has
+   already passed, FUNC is called on the next tick.  T must not
+   already be pending. */
+void
+timeout_add (struct timeout *t, int64_t expires,
+             timeout_func *func, void *aux)
+{
+  enum intr_level old_level;
+
+  ASSERT (t != NULL);
+  ASSERT (func != NULL);
+
+  old_level = intr_disable ();
+  t->expires = expires;
+  t->func = func;
+  t->aux = aux;
+  t->pending = true;
+  pending_cnt++;
+  file_timeout (t);
+  intr_set_level (old_level);
+}
+
+/* Cancels T.  Returns true if T was pending, false if it had
+   already expired or been cancelled. */
+bool
+timeout_cancel (struct timeout *t)
+{
+  enum intr_level old_level;
+  bool was_pending;
+
+  ASSERT (t != NULL);
+
+  old_level = intr_disable ();
+  was_pending = t->pending;
+  if (was_pending)
+    {
+      list_remove (&t->elem);
+      t->pending = false;
+      pending_cnt--;
+    }
+  intr_set_level (old_level);
+  return was_pending;
+}
+
+/* Returns the earliest tick at which timeout_run() may have work
+   to do, or INT64_MAX if no timeout is pending.  The result may
+   be earlier than the next expiration, when timeouts only need
+   to be cascaded, but never later.  Interrupts must be off. */
+int64_t
+timeout_next (void)
+{
+  int i;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (pending_cnt == 0)
+    return INT64_MAX;
+
+  /* Level 0 holds exactly the timeouts due in the next WHEEL_SIZE
+     ticks, one tick per slot. */
+  for (i = 0; i < WHEEL_SIZE; i++)
+    {
+      int64_t t = wheel_clock + i;
+      if (slot_index (t, 0) == 0 && i > 0)
+        break;
+      if (!list_empty (&wheel[0][slot_index (t, 0)]))
+        return t;
+    }
+
+  /* Otherwise the next thing to happen is a cascade, when level 0
+     next wraps around. */
+  return (wheel_clock + WHEEL_MASK) & ~(int64_t) WHEEL_MASK;
+}
+
+/* Expires every timeout due at or before tick NOW.  Called from
+   the timer interrupt. */
+void
+timeout_run (int64_t now)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  while (wheel_clock <= now)
+    {
+      struct list *slot = &wheel[0][slot_index (wheel_clock, 0)];
+      struct list expired;
+      int level;
+
+      /* On wrapping around level 0, pull the next batch down
+         from level 1, and so on up as higher levels wrap. */
+      for (level = 1; level < WHEEL_LEVELS; level++)
+        if (slot_index (wheel_clock, level - 1) != 0
+            || cascade (level) != 0)
+          break;
+
+      /* Detach the slot and advance the clock first, so that a
+         function that re-adds its own timeout lands in a slot
+         still to come rather than in this one. */
+      list_init (&expired);
+      while (!list_empty (slot))
+        list_push_back (&expired, list_pop_front (slot));
+      wheel_clock++;
+      while (!list_empty (&expired))
+        {
+          struct timeout *t = list_entry (list_pop_front (&expired),
+                                          struct timeout, elem);
+          t->pending = false;
+          pending_cnt--;
+          t->func (t, t->aux);
+        }
+    }
+}
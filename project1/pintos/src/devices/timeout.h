@@ -0,0 +1,40 @@
+#ifndef DEVICES_TIMEOUT_H
+#define DEVICES_TIMEOUT_H
+
+#include <list.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Kernel timeouts: a function to call from the timer interrupt
+   once timer_ticks() reaches a given value.
+
+   Pending timeouts are kept in a hierarchical timer wheel, so
+   adding and cancelling a timeout are O(1) and expiring them is
+   amortized O(1) per timeout, however many are pending.  Used
+   by timer_sleep() and sema_down_timeout(). */
+
+struct timeout;
+
+/* Called from the timer interrupt, with interrupts off, when
+   timeout T expires.  It may add or cancel timeouts, including
+   T itself. */
+typedef void timeout_func (struct timeout *t, void *aux);
+
+struct timeout
+  {
+    struct list_elem elem;      /* Element in a timer wheel slot. */
+    int64_t expires;            /* Tick at which to call FUNC. */
+    timeout_func *func;         /* Function to call. */
+    void *aux;                  /* Auxiliary data for FUNC. */
+    bool pending;               /* True if added and not yet expired
+                                   or cancelled. */
+  };
+
+void timeout_init (void);
+void timeout_add (struct timeout *, int64_t expires,
+                  timeout_func *, void *aux);
+bool timeout_cancel (struct timeout *);
+void timeout_run (int64_t now);
+int64_t timeout_next (void);
+
+#endif /* devices/timeout.h */
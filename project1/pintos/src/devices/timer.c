@@ -4,6 +4,7 @@
 #include <round.h>
 #include <stdio.h>
 #include "devices/pit.h"
+#include "devices/timeout.h"
 #include "threads/interrupt.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
@@ -24,7 +25,25 @@ static int64_t ticks;
    Initialized by timer_calibrate(). */
 static unsigned loops_per_tick;
 
+/* If false (default), the timer interrupts TIMER_FREQ times per
+   second, always.
+   If true, the idle thread stops the periodic tick while nothing
+   is runnable, and the PIT is instead set to interrupt once, when
+   the earliest pending timeout is due.
+   Controlled by kernel command-line option "-tickless". */
+bool timer_tickless;
+
+/* PIT cycles per timer tick, and the most ticks one PIT count
+   can span. */
+#define TICK_COUNT ((PIT_HZ + TIMER_FREQ / 2) / TIMER_FREQ)
+#define MAX_ONESHOT_TICKS (65535 / TICK_COUNT)
+
+/* Number of ticks that will have passed when the PIT's one-shot
+   count runs out, or 0 while the PIT is ticking periodically. */
+static int oneshot_ticks;
+
 static intr_handler_func timer_interrupt;
+static void advance_ticks (int n);
 static bool too_many_loops (unsigned loops);
 static void busy_wait (int64_t loops);
 static void real_time_sleep (int64_t num, int32_t denom);
@@ -35,6 +54,7 @@ static void real_time_delay (int64_t num, int32_t denom);
 void
 timer_init (void)
 {
+  timeout_init ();
   pit_configure_channel (0, 2, TIMER_FREQ);
   intr_register_ext (0x20, timer_interrupt, "8254 Timer");
 }
@@ -89,7 +109,7 @@ timer_elapsed (int64_t then)
 void
 timer_sleep (int64_t sleeping_ticks)
 {
-  if (ticks <= 0)
+  if (sleeping_ticks <= 0)
   {
     return;
   }
@@ -172,13 +192,88 @@ timer_print_stats (void)
   printf ("Timer: %"PRId64" ticks\n", timer_ticks ());
 }
 
+/* Called by the idle thread, with interrupts off, just before it
+   halts the CPU.  In tickless mode, replaces the periodic tick
+   by a single interrupt at the next tick when a timeout is due,
+   up to MAX_ONESHOT_TICKS away.  The count runs to the end of
+   the current tick first, so ticks stay on their usual
+   boundaries. */
+void
+timer_idle_enter (void)
+{
+  int64_t n;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (!timer_tickless || oneshot_ticks > 0 || intr_is_pending (0x20))
+    return;
+
+  n = timeout_next () - ticks;
+  if (n <= 1)
+    return;
+  if (n > MAX_ONESHOT_TICKS)
+    n = MAX_ONESHOT_TICKS;
+
+  pit_start_oneshot (0, pit_read_count (0) + (n - 1) * TICK_COUNT);
+  oneshot_ticks = n;
+}
+
+/* Called by intr_handler() on each external interrupt other than
+   the timer's, with interrupts off.  If the CPU was in tickless
+   idle, accounts for the whole ticks that passed while it was
+   halted and shortens the one-shot count to end with the current
+   tick, after which timer_interrupt() resumes periodic ticks.
+   Does nothing otherwise. */
+void
+timer_idle_exit (void)
+{
+  unsigned count;
+  int left;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  /* If the count has run out, the timer interrupt will take care
+     of everything as soon as interrupts are back on. */
+  if (oneshot_ticks == 0 || pit_output (0))
+    return;
+
+  /* One-shot tick boundaries fall every TICK_COUNT cycles,
+     counting back from the end of the count. */
+  count = pit_read_count (0);
+  left = DIV_ROUND_UP (count, TICK_COUNT);
+  pit_start_oneshot (0, count - (left - 1) * TICK_COUNT);
+  advance_ticks (oneshot_ticks - left);
+  oneshot_ticks = 1;
+}
+
 /* Timer interrupt handler. */
 static void
 timer_interrupt (struct intr_frame *args UNUSED)
 {
-  ticks++;
-  wakeup_sleeping_thread(timer_ticks());
-  thread_tick ();
+  int n = 1;
+
+  if (oneshot_ticks > 0)
+    {
+      /* Back from tickless idle: catch up on the ticks that the
+         one-shot count spanned and restart the periodic tick. */
+      n = oneshot_ticks;
+      oneshot_ticks = 0;
+      pit_configure_channel (0, 2, TIMER_FREQ);
+    }
+  advance_ticks (n);
+}
+
+/* Counts N timer ticks, one at a time, so that timeouts and the
+   scheduler see every tick. */
+static void
+advance_ticks (int n)
+{
+  while (n-- > 0)
+    {
+      ticks++;
+      timeout_run (ticks);
+      thread_tick ();
+    }
 }
 
 /* Returns true if LOOPS iterations waits for more than one timer
@@ -0,0 +1,173 @@
+#include "heap.h"
+#include "../debug.h"
+
+/* Each element's children form a list through `sibling', headed
+   by the parent's `child'.  `prev' points back along that list,
+   to the parent from the first child, so any element can be cut
+   out of the tree in O(1). */
+
+/* Makes the lesser of heap-ordered trees A and B the first child
+   of the other, and returns the new root. */
+static struct heap_elem *
+meld (struct heap *heap, struct heap_elem *a, struct heap_elem *b)
+{
+  if (a == NULL)
+    return b;
+  if (b == NULL)
+    return a;
+  if (heap->less (a, b, heap->aux))
+    {
+      struct heap_elem *t = a;
+      a = b;
+      b = t;
+    }
+
+  b->sibling = a->child;
+  if (a->child != NULL)
+    a->child->prev = b;
+  b->prev = a;
+  a->child = b;
+  a->sibling = a->prev = NULL;
+  return a;
+}
+
+/* Melds the list of trees starting at FIRST into one, in the
+   usual two passes: pairs left to right, then the pairs right to
+   left.  Returns the new root. */
+static struct heap_elem *
+merge_pairs (struct heap *heap, struct heap_elem *first)
+{
+  struct heap_elem *pairs = NULL;
+  struct heap_elem *root;
+
+  while (first != NULL)
+    {
+      struct heap_elem *a = first;
+      struct heap_elem *b = a->sibling;
+
+      first = b != NULL ? b->sibling : NULL;
+      a->sibling = a->prev = NULL;
+      if (b != NULL)
+        {
+          b->sibling = b->prev = NULL;
+          a = meld (heap, a, b);
+        }
+      a->sibling = pairs;
+      pairs = a;
+    }
+
+  root = NULL;
+  while (pairs != NULL)
+    {
+      struct heap_elem *next = pairs->sibling;
+      pairs->sibling = NULL;
+      root = meld (heap, root, pairs);
+      pairs = next;
+    }
+  return root;
+}
+
+/* Initializes HEAP as an empty heap ordered by LESS, given
+   auxiliary data AUX. */
+void
+heap_init (struct heap *heap, heap_less_func *less, void *aux)
+{
+  ASSERT (heap != NULL);
+  ASSERT (less != NULL);
+
+  heap->root = NULL;
+  heap->size = 0;
+  heap->less = less;
+  heap->aux = aux;
+}
+
+/* Inserts ELEM into HEAP. */
+void
+heap_push (struct heap *heap, struct heap_elem *elem)
+{
+  ASSERT (heap != NULL);
+  ASSERT (elem != NULL);
+
+  elem->child = elem->sibling = elem->prev = NULL;
+  heap->root = meld (heap, heap->root, elem);
+  heap->size++;
+}
+
+/* Returns the greatest element in HEAP, or a null pointer if
+   HEAP is empty. */
+struct heap_elem *
+heap_top (const struct heap *heap)
+{
+  ASSERT (heap != NULL);
+
+  return heap->root;
+}
+
+/* Removes and returns the greatest element in HEAP, which must
+   not be empty. */
+struct heap_elem *
+heap_pop (struct heap *heap)
+{
+  struct heap_elem *top;
+
+  ASSERT (heap != NULL);
+  ASSERT (heap->root != NULL);
+
+  top = heap->root;
+  heap->root = merge_pairs (heap, top->child);
+  heap->size--;
+  return top;
+}
+
+/* Removes ELEM, which must be in HEAP. */
+void
+heap_remove (struct heap *heap, struct heap_elem *elem)
+{
+  ASSERT (heap != NULL);
+  ASSERT (elem != NULL);
+
+  if (elem == heap->root)
+    {
+      heap_pop (heap);
+      return;
+    }
+
+  /* Cut ELEM's subtree out of the tree... */
+  if (elem->prev->child == elem)
+    elem->prev->child = elem->sibling;
+  else
+    elem->prev->sibling = elem->sibling;
+  if (elem->sibling != NULL)
+    elem->sibling->prev = elem->prev;
+
+  /* ...and put back its children without it. */
+  heap->root = meld (heap, heap->root, merge_pairs (heap, elem->child));
+  heap->size--;
+}
+
+/* Restores heap order after the key of ELEM, which must be in
+   HEAP, changed. */
+void
+heap_update (struct heap *heap, struct heap_elem *elem)
+{
+  heap_remove (heap, elem);
+  heap_push (heap, elem);
+}
+
+/* Returns the number of elements in HEAP. */
+size_t
+heap_size (const struct heap *heap)
+{
+  ASSERT (heap != NULL);
+
+  return heap->size;
+}
+
+/* Returns true if HEAP is empty, false otherwise. */
+bool
+heap_empty (const struct heap *heap)
+{
+  ASSERT (heap != NULL);
+
+  return heap->root == NULL;
+}
@@ -29,7 +29,11 @@ enum
     SYS_MKDIR,                  /* Create a directory. */
     SYS_READDIR,                /* Reads a directory entry. */
     SYS_ISDIR,                  /* Tests if a fd represents a directory. */
-    SYS_INUMBER                 /* Returns the inode number for a fd. */
+    SYS_INUMBER,                /* Returns the inode number for a fd. */
+
+    SYS_THREAD_STATS,           /* Gets a thread's scheduling statistics. */
+    SYS_SET_TICKETS,            /* Sets the stride scheduler's tickets. */
+    SYS_RT_ENROL                /* Enrols in the real-time class. */
   };
 
 #endif /* lib/syscall-nr.h */
@@ -0,0 +1,25 @@
+#ifndef __LIB_THREAD_STATS_H
+#define __LIB_THREAD_STATS_H
+
+#include <stdint.h>
+
+/* Scheduling statistics for one thread, kept by the scheduler
+   and returned to user programs by the thread_stats system call.
+   Times are in CPU cycles, as counted by the time-stamp counter
+   when the thread is switched in and out. */
+struct thread_stats
+  {
+    uint64_t run_cycles;        /* Time spent running. */
+    uint64_t ready_cycles;      /* Time spent ready but not running. */
+    uint64_t max_ready_cycles;  /* Longest single wait to be run. */
+    uint32_t dispatch_cnt;      /* Times switched in. */
+    uint32_t voluntary_cnt;     /* Times switched out by blocking or
+                                   exiting. */
+    uint32_t involuntary_cnt;   /* Times switched out while still
+                                   ready to run. */
+    uint32_t preempt_cnt;       /* Those of them forced by an
+                                   interrupt, e.g. at the end of a
+                                   time slice. */
+  };
+
+#endif /* lib/thread-stats.h */
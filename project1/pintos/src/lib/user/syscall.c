@@ -188,3 +188,21 @@ inumber (int fd)
 {
   return syscall1 (SYS_INUMBER, fd);
 }
+
+bool
+thread_stats (pid_t pid, struct thread_stats *stats)
+{
+  return syscall2 (SYS_THREAD_STATS, pid, stats);
+}
+
+bool
+set_tickets (int tickets)
+{
+  return syscall1 (SYS_SET_TICKETS, tickets);
+}
+
+bool
+rt_enrol (int period, int budget)
+{
+  return syscall2 (SYS_RT_ENROL, period, budget);
+}
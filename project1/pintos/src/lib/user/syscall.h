@@ -3,6 +3,7 @@
 
 #include <stdbool.h>
 #include <debug.h>
+#include <thread-stats.h>
 
 /* Process identifier. */
 typedef int pid_t;
@@ -46,4 +47,9 @@ bool readdir (int fd, char name[READDIR_MAX_LEN + 1]);
 bool isdir (int fd);
 int inumber (int fd);
 
+/* Scheduler statistics. */
+bool thread_stats (pid_t, struct thread_stats *);
+bool set_tickets (int tickets);
+bool rt_enrol (int period, int budget);
+
 #endif /* lib/user/syscall.h */
@@ -0,0 +1,56 @@
+/* The main thread enrols in the real-time class, after which it
+   should run ahead of even a PRI_MAX thread.  A second thread
+   asking for more than is left should be turned away, and then
+   admitted with a smaller reservation. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+static thread_func high_thread_func;
+static thread_func second_thread_func;
+
+static const char *
+verdict (bool admitted)
+{
+  return admitted ? "admitted" : "rejected";
+}
+
+void
+test_rt_admit (void)
+{
+  struct semaphore done;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  msg ("Enrolling with a budget of 50 in 100 ticks: %s.",
+       verdict (thread_set_realtime (100, 50)));
+  thread_create ("high", PRI_MAX, high_thread_func, NULL);
+  msg ("The real-time thread runs ahead of the PRI_MAX thread.");
+
+  sema_init (&done, 0);
+  thread_create ("second", PRI_DEFAULT, second_thread_func, &done);
+  sema_down (&done);
+  thread_set_realtime (0, 0);
+  msg ("Back to normal scheduling.");
+}
+
+static void
+high_thread_func (void *aux UNUSED)
+{
+  msg ("PRI_MAX thread running.");
+}
+
+static void
+second_thread_func (void *done)
+{
+  msg ("Enrolling another with a budget of 50 in 100 ticks: %s.",
+       verdict (thread_set_realtime (100, 50)));
+  msg ("Enrolling another with a budget of 40 in 100 ticks: %s.",
+       verdict (thread_set_realtime (100, 40)));
+  thread_set_realtime (0, 0);
+  sema_up (done);
+}
@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rt-admit) begin
+(rt-admit) Enrolling with a budget of 50 in 100 ticks: admitted.
+(rt-admit) The real-time thread runs ahead of the PRI_MAX thread.
+(rt-admit) PRI_MAX thread running.
+(rt-admit) Enrolling another with a budget of 50 in 100 ticks: rejected.
+(rt-admit) Enrolling another with a budget of 40 in 100 ticks: admitted.
+(rt-admit) Back to normal scheduling.
+(rt-admit) end
+EOF
+pass;
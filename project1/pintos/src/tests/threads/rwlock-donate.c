@@ -0,0 +1,78 @@
+/* Two low-priority threads hold an rwlock for reading, each
+   then blocking on a semaphore of its own, when a high-priority
+   writer tries to acquire it.  The writer must donate its
+   priority to both readers.  Each reader loses the donation as
+   it releases the lock, and the writer gets the lock as soon as
+   the second reader lets go. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+struct reader_data
+  {
+    const char *name;           /* Reader's name. */
+    int priority;               /* Reader's base priority. */
+    struct rwlock *rwlock;      /* Shared rwlock. */
+    struct semaphore go;        /* Reader waits on this. */
+  };
+
+static thread_func reader_thread_func;
+static thread_func writer_thread_func;
+
+void
+test_rwlock_donate (void)
+{
+  struct rwlock rwlock;
+  struct reader_data readers[2];
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  rwlock_init (&rwlock);
+  for (i = 0; i < 2; i++)
+    {
+      struct reader_data *r = &readers[i];
+      r->name = i == 0 ? "reader1" : "reader2";
+      r->priority = PRI_DEFAULT + 1 + i;
+      r->rwlock = &rwlock;
+      sema_init (&r->go, 0);
+      thread_create (r->name, r->priority, reader_thread_func, r);
+    }
+  thread_create ("writer", PRI_DEFAULT + 5, writer_thread_func, &rwlock);
+
+  for (i = 0; i < 2; i++)
+    sema_up (&readers[i].go);
+}
+
+static void
+reader_thread_func (void *r_)
+{
+  struct reader_data *r = r_;
+
+  rwlock_acquire_read (r->rwlock);
+  msg ("%s: got the lock for reading", r->name);
+  sema_down (&r->go);
+  msg ("%s: should have priority %d.  Actual priority: %d.",
+       r->name, PRI_DEFAULT + 5, thread_get_priority ());
+  rwlock_release_read (r->rwlock);
+  msg ("%s: should have priority %d.  Actual priority: %d.",
+       r->name, r->priority, thread_get_priority ());
+}
+
+static void
+writer_thread_func (void *rwlock_)
+{
+  struct rwlock *rwlock = rwlock_;
+
+  rwlock_acquire_write (rwlock);
+  msg ("writer: got the lock for writing");
+  rwlock_release_write (rwlock);
+  msg ("writer: done");
+}
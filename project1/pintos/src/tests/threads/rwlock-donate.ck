@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rwlock-donate) begin
+(rwlock-donate) reader1: got the lock for reading
+(rwlock-donate) reader2: got the lock for reading
+(rwlock-donate) reader1: should have priority 36.  Actual priority: 36.
+(rwlock-donate) reader1: should have priority 32.  Actual priority: 32.
+(rwlock-donate) reader2: should have priority 36.  Actual priority: 36.
+(rwlock-donate) writer: got the lock for writing
+(rwlock-donate) writer: done
+(rwlock-donate) reader2: should have priority 33.  Actual priority: 33.
+(rwlock-donate) end
+EOF
+pass;
@@ -0,0 +1,57 @@
+/* The main thread holds an rwlock for writing while a
+   lower-priority writer waits for it.  Releasing the lock hands
+   it over to the writer, which cannot run yet, and the main
+   thread at once tries to acquire it again.  The lock belongs to
+   the writer now, so the main thread must wait for the writer to
+   finish with it, donating its priority so that the writer does
+   so right away. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+static thread_func writer_thread_func;
+
+void
+test_rwlock_handover (void)
+{
+  struct rwlock rwlock;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  rwlock_init (&rwlock);
+  rwlock_acquire_write (&rwlock);
+  thread_create ("writer", PRI_DEFAULT - 1, writer_thread_func, &rwlock);
+
+  /* Let the writer start waiting. */
+  timer_sleep (1);
+
+  msg ("Releasing and reacquiring the lock.");
+  rwlock_release_write (&rwlock);
+  rwlock_acquire_write (&rwlock);
+  msg ("Got the lock back.");
+  rwlock_release_write (&rwlock);
+
+  /* Let the writer finish. */
+  timer_sleep (1);
+  msg ("The writer must already have finished.");
+}
+
+static void
+writer_thread_func (void *rwlock_)
+{
+  struct rwlock *rwlock = rwlock_;
+
+  rwlock_acquire_write (rwlock);
+  msg ("writer: got the lock for writing, priority %d",
+       thread_get_priority ());
+  rwlock_release_write (rwlock);
+  msg ("writer: done");
+}
@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rwlock-handover) begin
+(rwlock-handover) Releasing and reacquiring the lock.
+(rwlock-handover) writer: got the lock for writing, priority 31
+(rwlock-handover) Got the lock back.
+(rwlock-handover) writer: done
+(rwlock-handover) The writer must already have finished.
+(rwlock-handover) end
+EOF
+pass;
@@ -0,0 +1,61 @@
+/* The main thread holds more rwlocks at once than a thread has
+   built-in hold records for, some for reading and some for
+   writing, while a higher-priority writer waits for the last of
+   them.  The writer must still donate its priority through that
+   rwlock, and get it as soon as the main thread releases it. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+#define RWLOCK_CNT (RWLOCK_HOLD_MAX * 2)
+
+static thread_func writer_thread_func;
+
+void
+test_rwlock_nest (void)
+{
+  struct rwlock rwlocks[RWLOCK_CNT];
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  for (i = 0; i < RWLOCK_CNT; i++)
+    {
+      rwlock_init (&rwlocks[i]);
+      if (i % 2 == 0)
+        rwlock_acquire_read (&rwlocks[i]);
+      else
+        rwlock_acquire_write (&rwlocks[i]);
+    }
+  thread_create ("writer", PRI_DEFAULT + 1, writer_thread_func,
+                 &rwlocks[RWLOCK_CNT - 1]);
+  msg ("Holding %d rwlocks.  This thread should have priority %d.  "
+       "Actual priority: %d.", RWLOCK_CNT, PRI_DEFAULT + 1,
+       thread_get_priority ());
+
+  for (i = RWLOCK_CNT - 1; i >= 0; i--)
+    if (i % 2 == 0)
+      rwlock_release_read (&rwlocks[i]);
+    else
+      rwlock_release_write (&rwlocks[i]);
+  msg ("Released them all.  This thread should have priority %d.  "
+       "Actual priority: %d.", PRI_DEFAULT, thread_get_priority ());
+}
+
+static void
+writer_thread_func (void *rwlock_)
+{
+  struct rwlock *rwlock = rwlock_;
+
+  rwlock_acquire_write (rwlock);
+  msg ("writer: got the lock for writing");
+  rwlock_release_write (rwlock);
+  msg ("writer: done");
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rwlock-nest) begin
+(rwlock-nest) Holding 8 rwlocks.  This thread should have priority 32.  Actual priority: 32.
+(rwlock-nest) writer: got the lock for writing
+(rwlock-nest) writer: done
+(rwlock-nest) Released them all.  This thread should have priority 31.  Actual priority: 31.
+(rwlock-nest) end
+EOF
+pass;
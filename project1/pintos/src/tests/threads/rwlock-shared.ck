@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rwlock-shared) begin
+(rwlock-shared) reader: got the lock for reading
+(rwlock-shared) reader: done
+(rwlock-shared) This thread should have priority 32.  Actual priority: 32.
+(rwlock-shared) writer: got the lock for writing
+(rwlock-shared) writer: done
+(rwlock-shared) The reader and then the writer must already have finished.
+(rwlock-shared) end
+EOF
+pass;
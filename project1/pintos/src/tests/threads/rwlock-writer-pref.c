@@ -0,0 +1,58 @@
+/* The main thread holds an rwlock for reading while first a
+   writer and then a higher-priority reader try to acquire it.
+   Because a writer is waiting, the reader must wait too, even
+   though the lock is only held for reading.  When the main
+   thread releases the lock, the writer gets it first, and then
+   the reader. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+static thread_func reader_thread_func;
+static thread_func writer_thread_func;
+
+void
+test_rwlock_writer_pref (void)
+{
+  struct rwlock rwlock;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  rwlock_init (&rwlock);
+  rwlock_acquire_read (&rwlock);
+  thread_create ("writer", PRI_DEFAULT + 1, writer_thread_func, &rwlock);
+  thread_create ("reader", PRI_DEFAULT + 2, reader_thread_func, &rwlock);
+  msg ("This thread should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT + 2, thread_get_priority ());
+  rwlock_release_read (&rwlock);
+  msg ("The writer and then the reader must already have finished.");
+}
+
+static void
+reader_thread_func (void *rwlock_)
+{
+  struct rwlock *rwlock = rwlock_;
+
+  rwlock_acquire_read (rwlock);
+  msg ("reader: got the lock for reading");
+  rwlock_release_read (rwlock);
+  msg ("reader: done");
+}
+
+static void
+writer_thread_func (void *rwlock_)
+{
+  struct rwlock *rwlock = rwlock_;
+
+  rwlock_acquire_write (rwlock);
+  msg ("writer: got the lock for writing");
+  rwlock_release_write (rwlock);
+  msg ("writer: done");
+}
@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rwlock-writer-pref) begin
+(rwlock-writer-pref) This thread should have priority 33.  Actual priority: 33.
+(rwlock-writer-pref) writer: got the lock for writing
+(rwlock-writer-pref) reader: got the lock for reading
+(rwlock-writer-pref) reader: done
+(rwlock-writer-pref) writer: done
+(rwlock-writer-pref) The writer and then the reader must already have finished.
+(rwlock-writer-pref) end
+EOF
+pass;
@@ -29,6 +29,13 @@ static const struct test tests[] =
     {"priority-preempt", test_priority_preempt},
     {"priority-sema", test_priority_sema},
     {"priority-condvar", test_priority_condvar},
+    {"rwlock-shared", test_rwlock_shared},
+    {"rwlock-writer-pref", test_rwlock_writer_pref},
+    {"rwlock-donate", test_rwlock_donate},
+    {"rwlock-handover", test_rwlock_handover},
+    {"rwlock-nest", test_rwlock_nest},
+    {"workqueue", test_workqueue},
+    {"rt-admit", test_rt_admit},
     {"mlfqs-load-1", test_mlfqs_load_1},
     {"mlfqs-load-60", test_mlfqs_load_60},
     {"mlfqs-load-avg", test_mlfqs_load_avg},
@@ -38,6 +45,7 @@ static const struct test tests[] =
     {"mlfqs-nice-2", test_mlfqs_nice_2},
     {"mlfqs-nice-10", test_mlfqs_nice_10},
     {"mlfqs-block", test_mlfqs_block},
+    {"stride-share", test_stride_share},
   };
 
 static const char *test_name;
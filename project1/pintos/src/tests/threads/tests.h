@@ -23,6 +23,13 @@ extern test_func test_priority_fifo;
 extern test_func test_priority_preempt;
 extern test_func test_priority_sema;
 extern test_func test_priority_condvar;
+extern test_func test_rwlock_shared;
+extern test_func test_rwlock_writer_pref;
+extern test_func test_rwlock_donate;
+extern test_func test_rwlock_handover;
+extern test_func test_rwlock_nest;
+extern test_func test_workqueue;
+extern test_func test_rt_admit;
 extern test_func test_mlfqs_load_1;
 extern test_func test_mlfqs_load_60;
 extern test_func test_mlfqs_load_avg;
@@ -32,6 +39,7 @@ extern test_func test_mlfqs_fair_20;
 extern test_func test_mlfqs_nice_2;
 extern test_func test_mlfqs_nice_10;
 extern test_func test_mlfqs_block;
+extern test_func test_stride_share;
 
 void msg (const char *, ...);
 void fail (const char *, ...);
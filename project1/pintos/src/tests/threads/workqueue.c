@@ -0,0 +1,77 @@
+/* Work scheduled from an interrupt handler for a worker that
+   outranks the interrupted thread should run as soon as the
+   handler returns.  Work for a lower-priority worker should wait
+   until the scheduling thread blocks. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/workqueue.h"
+#include "devices/timeout.h"
+#include "devices/timer.h"
+
+static timeout_func schedule_high;
+static work_func high_work_func;
+static work_func low_work_func;
+
+static volatile int64_t fired_tick;
+static volatile int64_t ran_tick;
+
+void
+test_workqueue (void)
+{
+  struct timeout timeout;
+  struct work high_work, low_work;
+  struct semaphore done;
+  int64_t start;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  /* Busy-wait, so the timer interrupts us, until the work that
+     the timeout schedules has run. */
+  fired_tick = ran_tick = -1;
+  work_init (&high_work, high_work_func, NULL, WORK_HIGH);
+  timeout_add (&timeout, timer_ticks () + 5, schedule_high, &high_work);
+  start = timer_ticks ();
+  while (ran_tick < 0)
+    if (timer_elapsed (start) > TIMER_FREQ)
+      fail ("high-priority work did not run");
+  if (ran_tick != fired_tick)
+    fail ("high-priority work ran at tick %lld, scheduled at tick %lld",
+          ran_tick, fired_tick);
+  msg ("High-priority work ran as soon as the interrupt returned.");
+
+  sema_init (&done, 0);
+  work_init (&low_work, low_work_func, &done, WORK_LOW);
+  work_schedule (&low_work);
+  msg ("Low-priority work should not have run yet.");
+  sema_down (&done);
+  msg ("Low-priority work must already have run.");
+}
+
+static void
+schedule_high (struct timeout *t UNUSED, void *work)
+{
+  fired_tick = timer_ticks ();
+  work_schedule (work);
+}
+
+static void
+high_work_func (struct work *w UNUSED, void *aux UNUSED)
+{
+  ran_tick = timer_ticks ();
+}
+
+static void
+low_work_func (struct work *w UNUSED, void *done)
+{
+  msg ("Low-priority work running.");
+  sema_up (done);
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(workqueue) begin
+(workqueue) High-priority work ran as soon as the interrupt returned.
+(workqueue) Low-priority work should not have run yet.
+(workqueue) Low-priority work running.
+(workqueue) Low-priority work must already have run.
+(workqueue) end
+EOF
+pass;
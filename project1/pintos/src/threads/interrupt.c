@@ -225,6 +225,30 @@ intr_yield_on_return (void)
   yield_on_return = true;
 }
 
+/* Returns true if external interrupt VEC has been raised but not
+   yet delivered, as happens while interrupts are off. */
+bool
+intr_is_pending (uint8_t vec)
+{
+  uint8_t irr;
+
+  ASSERT (vec >= 0x20 && vec < 0x30);
+
+  /* OCW3: make the next read of the control port return the
+     Interrupt Request Register. */
+  if (vec < 0x28)
+    {
+      outb (PIC0_CTRL, 0x0a);
+      irr = inb (PIC0_CTRL);
+    }
+  else
+    {
+      outb (PIC1_CTRL, 0x0a);
+      irr = inb (PIC1_CTRL);
+    }
+  return (irr & (1 << (vec & 7))) != 0;
+}
+
 /* 8259A Programmable Interrupt Controller. */
 
 /* Initializes the PICs.  Refer to [8259A] for details.
@@ -359,6 +383,13 @@ intr_handler (struct intr_frame *frame)
 
       in_external_intr = true;
       yield_on_return = false;
+
+      /* If this interrupt cut tickless idle short, catch up on
+         the ticks that passed before the handler wakes anyone,
+         who would otherwise run with a stale clock and no time
+         slice until the one-shot count ran out. */
+      if (frame->vec_no != 0x20)
+        timer_idle_exit ();
     }
 
   /* Invoke the interrupt's handler. */
@@ -384,7 +415,7 @@ intr_handler (struct intr_frame *frame)
       pic_end_of_interrupt (frame->vec_no);
 
       if (yield_on_return)
-        thread_yield ();
+        thread_preempt ();
     }
 }
 
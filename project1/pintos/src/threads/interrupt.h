@@ -63,6 +63,7 @@ void intr_register_int (uint8_t vec, int dpl, enum intr_level,
                         intr_handler_func *, const char *name);
 bool intr_context (void);
 void intr_yield_on_return (void);
+bool intr_is_pending (uint8_t vec);
 
 void intr_dump_frame (const struct intr_frame *);
 const char *intr_name (uint8_t vec);
@@ -30,10 +30,19 @@
 #include <stdio.h>
 #include <string.h>
 #include "threads/interrupt.h"
+#include "threads/malloc.h"
 #include "threads/thread.h"
+#include "devices/timeout.h"
+#include "devices/timer.h"
 
-/* use to sort &cond->waiters */
-bool waiters_cmp_priority (const struct list_elem *a, const struct list_elem *b, void *aux UNUSED);
+/* Source of wait_seq values, so that waiters of equal priority
+   are woken in the order they arrived. */
+static unsigned next_wait_seq;
+
+static heap_less_func sema_waiter_less;
+static heap_less_func lock_waiter_less;
+static heap_less_func cond_waiter_less;
+static void sema_enqueue (struct semaphore *, struct thread *);
 
 /* Initializes semaphore SEMA to VALUE.  A semaphore is a
    nonnegative integer along with two atomic operators for
@@ -50,7 +59,7 @@ sema_init (struct semaphore *sema, unsigned value)
   ASSERT (sema != NULL);
 
   sema->value = value;
-  list_init (&sema->waiters);
+  heap_init (&sema->waiters, sema_waiter_less, NULL);
 }
 
 /* Down or "P" operation on a semaphore.  Waits for SEMA's value
@@ -71,7 +80,7 @@ sema_down (struct semaphore *sema)
   old_level = intr_disable ();
   while (sema->value == 0)
     {
-      list_push_back (&sema->waiters, &thread_current ()->elem);
+      sema_enqueue (sema, thread_current ());
       thread_block ();
     }
   sema->value--;
@@ -104,6 +113,59 @@ sema_try_down (struct semaphore *sema)
   return success;
 }
 
+/* Timeout callback for sema_down_timeout(): if thread T_ is
+   still blocked on the semaphore, takes it off the wait list and
+   lets it run so it can notice that time is up.  If a sema_up()
+   already woke it, there is nothing to do. */
+static void
+sema_timeout_expired (struct timeout *to UNUSED, void *t_)
+{
+  struct thread *t = t_;
+
+  if (t->sema_waiting != NULL)
+    {
+      heap_remove (&t->sema_waiting->waiters, &t->waiter_elem);
+      t->sema_waiting = NULL;
+      thread_unblock (t);
+    }
+}
+
+/* Like sema_down(), but gives up after TICKS timer ticks.
+   Returns true if SEMA was decremented, false if the wait timed
+   out.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+bool
+sema_down_timeout (struct semaphore *sema, int64_t ticks)
+{
+  enum intr_level old_level;
+  int64_t deadline;
+  struct timeout to;
+
+  ASSERT (sema != NULL);
+  ASSERT (!intr_context ());
+
+  old_level = intr_disable ();
+  deadline = timer_ticks () + ticks;
+  to.pending = false;
+  while (sema->value == 0)
+    {
+      if (timer_ticks () >= deadline)
+        {
+          intr_set_level (old_level);
+          return false;
+        }
+      sema_enqueue (sema, thread_current ());
+      timeout_add (&to, deadline, sema_timeout_expired, thread_current ());
+      thread_block ();
+      timeout_cancel (&to);
+    }
+  sema->value--;
+  intr_set_level (old_level);
+  return true;
+}
+
 /* Up or "V" operation on a semaphore.  Increments SEMA's value
    and wakes up one thread of those waiting for SEMA, if any.
 
@@ -112,18 +174,31 @@ void
 sema_up (struct semaphore *sema)
 {
   enum intr_level old_level;
+  bool preempt = false;
 
   ASSERT (sema != NULL);
 
   old_level = intr_disable ();
-  if (!list_empty (&sema->waiters))
+  if (!heap_empty (&sema->waiters))
   {
-    list_sort(&sema->waiters, (list_less_func *) &thread_cmp_priority, NULL);
-    thread_unblock (list_entry (list_pop_front (&sema->waiters), struct thread, elem));
+    struct thread *t = heap_entry (heap_pop (&sema->waiters), struct thread, waiter_elem);
+    t->sema_waiting = NULL;
+    thread_unblock (t);
+    preempt = thread_outranks_current (t);
   }
   sema->value++;
   intr_set_level (old_level);
-  thread_yield();
+
+  /* Let a woken thread that outranks us run at once.  An interrupt
+     handler, such as the disk's, can't yield itself: it does so
+     once the handler returns. */
+  if (preempt)
+  {
+    if (intr_context ())
+      intr_yield_on_return ();
+    else
+      thread_yield();
+  }
 }
 
 static void sema_test_helper (void *sema_);
@@ -187,7 +262,7 @@ lock_init (struct lock *lock)
   lock->max_priority = PRI_MIN;
   sema_init (&lock->semaphore, 1);
   enum intr_level old_level = intr_disable();
-  list_init(&lock->threads_waiting);
+  heap_init(&lock->threads_waiting, lock_waiter_less, NULL);
   intr_set_level (old_level);
 }
 
@@ -212,7 +287,7 @@ lock_acquire (struct lock *lock)
   if (!thread_mlfqs)
   {
     thread_current()->lock_waiting = lock;
-    list_push_back(&lock->threads_waiting, &thread_current()->loc_elem);
+    heap_push(&lock->threads_waiting, &thread_current()->loc_elem);
     if (thread_current()->priority > lock->max_priority)
     {
       lock->max_priority = thread_current()->priority;
@@ -235,7 +310,7 @@ lock_acquire (struct lock *lock)
   {
     thread_current()->lock_waiting = NULL;
     list_push_back(&thread_current()->locks_holding, &lock->loc_elem);
-    list_remove(&thread_current()->loc_elem);
+    heap_remove(&lock->threads_waiting, &thread_current()->loc_elem);
     lock->max_priority = lock_get_max_priority(lock);
   }
   intr_set_level(old_level);
@@ -312,14 +387,386 @@ lock_held_by_current_thread (const struct lock *lock)
   return lock->holder == thread_current ();
 }
 
+static void rwlock_wait (struct rwlock *, struct semaphore *queue);
+static bool rwlock_hand_over (struct rwlock *, bool readers_first);
+static void rwlock_reserve_hold (void);
+static void rwlock_add_holder (struct rwlock *, struct thread *);
+static struct rwlock_hold *rwlock_remove_holder (struct rwlock *,
+                                                 struct thread *);
+static void rwlock_free_hold (struct rwlock_hold *);
+static struct thread *rwlock_top_waiter (struct rwlock *);
+static struct thread *sema_wake (struct semaphore *);
+
+/* Initializes RW as an rwlock that no thread holds. */
+void
+rwlock_init (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+
+  rw->readers = 0;
+  rw->writer = NULL;
+  rw->readers_waiting = 0;
+  rw->writers_waiting = 0;
+  sema_init (&rw->read_queue, 0);
+  sema_init (&rw->write_queue, 0);
+  list_init (&rw->holders);
+}
+
+/* Acquires RW for reading, sleeping while a thread holds it for
+   writing or waits to.  The current thread must not hold RW
+   already.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_acquire_read (struct rwlock *rw)
+{
+  enum intr_level old_level;
+
+  ASSERT (rw != NULL);
+  ASSERT (!intr_context ());
+
+  rwlock_reserve_hold ();
+  old_level = intr_disable ();
+  if (rw->writer == NULL && rw->writers_waiting == 0)
+    {
+      rw->readers++;
+      rwlock_add_holder (rw, thread_current ());
+    }
+  else
+    {
+      rw->readers_waiting++;
+      rwlock_wait (rw, &rw->read_queue);
+    }
+  intr_set_level (old_level);
+}
+
+/* Releases RW, which the current thread must hold for reading.
+   Yields if that lets in a thread that outranks the current one
+   or gives up a donated priority. */
+void
+rwlock_release_read (struct rwlock *rw)
+{
+  struct thread *cur = thread_current ();
+  int old_priority = cur->priority;
+  struct rwlock_hold *hold;
+  enum intr_level old_level;
+  bool preempt = false;
+
+  ASSERT (rw != NULL);
+  ASSERT (rw->readers > 0 && rw->writer == NULL);
+
+  old_level = intr_disable ();
+  rw->readers--;
+  hold = rwlock_remove_holder (rw, cur);
+  if (rw->readers == 0)
+    preempt = rwlock_hand_over (rw, false);
+  intr_set_level (old_level);
+
+  rwlock_free_hold (hold);
+  if (preempt || cur->priority < old_priority)
+    thread_yield ();
+}
+
+/* Acquires RW for writing, sleeping while any other thread holds
+   it.  The current thread must not hold RW already.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_acquire_write (struct rwlock *rw)
+{
+  enum intr_level old_level;
+
+  ASSERT (rw != NULL);
+  ASSERT (!intr_context ());
+
+  rwlock_reserve_hold ();
+  old_level = intr_disable ();
+  if (rw->writer == NULL && rw->readers == 0)
+    {
+      rw->writer = thread_current ();
+      rwlock_add_holder (rw, thread_current ());
+    }
+  else
+    {
+      rw->writers_waiting++;
+      rwlock_wait (rw, &rw->write_queue);
+    }
+  intr_set_level (old_level);
+}
+
+/* Releases RW, which the current thread must hold for writing.
+   Yields under the same conditions as rwlock_release_read(). */
+void
+rwlock_release_write (struct rwlock *rw)
+{
+  struct thread *cur = thread_current ();
+  int old_priority = cur->priority;
+  struct rwlock_hold *hold;
+  enum intr_level old_level;
+  bool preempt;
+
+  ASSERT (rw != NULL);
+  ASSERT (rwlock_held_for_write (rw));
+
+  old_level = intr_disable ();
+  rw->writer = NULL;
+  hold = rwlock_remove_holder (rw, cur);
+  preempt = rwlock_hand_over (rw, true);
+  intr_set_level (old_level);
+
+  rwlock_free_hold (hold);
+  if (preempt || cur->priority < old_priority)
+    thread_yield ();
+}
+
+/* Returns true if the current thread holds RW for writing, false
+   otherwise. */
+bool
+rwlock_held_for_write (const struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+
+  return rw->writer == thread_current ();
+}
+
+/* Blocks the current thread on QUEUE, one of RW's, until a
+   releasing thread hands RW over to it.  Meanwhile the current
+   thread donates its priority to RW's holders.  Interrupts must
+   be off.
+
+   The queues' values stay 0, so only rwlock_hand_over() can let a
+   waiter through: a thread that arrives between the hand-over and
+   the woken thread running finds RW held and waits its turn. */
+static void
+rwlock_wait (struct rwlock *rw, struct semaphore *queue)
+{
+  struct thread *cur = thread_current ();
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (!thread_mlfqs)
+    {
+      cur->rwlock_waiting = rw;
+      rwlock_donate (rw, cur);
+    }
+  sema_enqueue (queue, cur);
+  thread_block ();
+  ASSERT (queue != &rw->write_queue || rw->writer == cur);
+}
+
+/* Called when RW has just become free.  Lets in the next writer
+   or every reader that was waiting, the readers first if
+   READERS_FIRST.  The last reader out prefers a writer, since
+   waiting writers keep new readers out, and a writer prefers the
+   readers that queued up behind it, so neither side starves.  The
+   threads let in are counted as holders here, before they run.
+   Returns true if one of them outranks the running thread.
+   Interrupts must be off. */
+static bool
+rwlock_hand_over (struct rwlock *rw, bool readers_first)
+{
+  struct thread *top;
+  struct list_elem *e;
+  bool preempt = false;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (rw->writer == NULL && rw->readers == 0);
+
+  if (rw->readers_waiting > 0 && (readers_first || rw->writers_waiting == 0))
+    while (rw->readers_waiting > 0)
+      {
+        struct thread *reader = sema_wake (&rw->read_queue);
+        rw->readers_waiting--;
+        rw->readers++;
+        rwlock_add_holder (rw, reader);
+        preempt = preempt || thread_outranks_current (reader);
+      }
+  else if (rw->writers_waiting > 0)
+    {
+      rw->writers_waiting--;
+      rw->writer = sema_wake (&rw->write_queue);
+      rwlock_add_holder (rw, rw->writer);
+      preempt = thread_outranks_current (rw->writer);
+    }
+  else
+    return false;
+
+  /* The new holders inherit the donations of whoever still
+     waits. */
+  top = rwlock_top_waiter (rw);
+  if (top != NULL && !thread_mlfqs)
+    for (e = list_begin (&rw->holders); e != list_end (&rw->holders);
+         e = list_next (e))
+      {
+        struct thread *holder = list_entry (e, struct rwlock_hold, elem)->thread;
+        if (top->priority > holder->priority)
+          priority_donation (top, holder);
+      }
+  return preempt;
+}
+
+/* Donates T's priority, if greater, to every holder of RW, which
+   T is waiting for.  Interrupts must be off. */
+void
+rwlock_donate (struct rwlock *rw, struct thread *t)
+{
+  struct list_elem *e;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  for (e = list_begin (&rw->holders); e != list_end (&rw->holders);
+       e = list_next (e))
+    {
+      struct thread *holder = list_entry (e, struct rwlock_hold, elem)->thread;
+      if (t->priority > holder->priority)
+        priority_donation (t, holder);
+    }
+}
+
+/* Returns the highest priority among threads waiting for RW, or
+   PRI_MIN if there are none. */
+int
+rwlock_get_max_priority (struct rwlock *rw)
+{
+  struct thread *top = rwlock_top_waiter (rw);
+
+  return top != NULL ? top->priority : PRI_MIN;
+}
+
+/* Returns the highest-priority thread waiting for RW, or a null
+   pointer if there is none. */
+static struct thread *
+rwlock_top_waiter (struct rwlock *rw)
+{
+  struct thread *r = NULL, *w = NULL;
+
+  if (!heap_empty (&rw->read_queue.waiters))
+    r = heap_entry (heap_top (&rw->read_queue.waiters), struct thread, waiter_elem);
+  if (!heap_empty (&rw->write_queue.waiters))
+    w = heap_entry (heap_top (&rw->write_queue.waiters), struct thread, waiter_elem);
+  if (r == NULL || (w != NULL && w->priority > r->priority))
+    return w;
+  return r;
+}
+
+/* Sets aside a hold record for the rwlock that the current thread
+   is about to acquire: a built-in one if one is free, otherwise
+   one from the heap.  Must be called with interrupts on, before
+   the rwlock is taken, since rwlock_hand_over() may record the
+   thread as a holder on its behalf.  If memory has run out too,
+   the thread makes do without one: it still gets the rwlock, but
+   nobody waiting can donate priority to it through it. */
+static void
+rwlock_reserve_hold (void)
+{
+  struct thread *cur = thread_current ();
+  struct rwlock_hold *hold = NULL;
+  int i;
+
+  for (i = 0; i < RWLOCK_HOLD_MAX; i++)
+    if (cur->rwlock_holds[i].thread == NULL)
+      {
+        hold = &cur->rwlock_holds[i];
+        break;
+      }
+  if (hold == NULL)
+    hold = malloc (sizeof *hold);
+  if (hold != NULL)
+    {
+      hold->rwlock = NULL;
+      hold->thread = cur;
+    }
+  cur->rwlock_hold_next = hold;
+}
+
+/* Records that T holds RW, and so no longer waits for it, in the
+   hold record that T set aside. */
+static void
+rwlock_add_holder (struct rwlock *rw, struct thread *t)
+{
+  struct rwlock_hold *hold = t->rwlock_hold_next;
+
+  t->rwlock_waiting = NULL;
+  t->rwlock_hold_next = NULL;
+  if (hold == NULL)
+    return;
+
+  hold->rwlock = rw;
+  list_push_back (&rw->holders, &hold->elem);
+  list_push_back (&t->rwlocks_held, &hold->thread_elem);
+}
+
+/* Records that T no longer holds RW, and drops any priority that
+   was donated to T through RW.  Returns T's hold record for RW,
+   to be passed to rwlock_free_hold() once interrupts are back
+   on, or a null pointer if T had none. */
+static struct rwlock_hold *
+rwlock_remove_holder (struct rwlock *rw, struct thread *t)
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&t->rwlocks_held); e != list_end (&t->rwlocks_held);
+       e = list_next (e))
+    {
+      struct rwlock_hold *hold = list_entry (e, struct rwlock_hold,
+                                             thread_elem);
+      if (hold->rwlock == rw)
+        {
+          list_remove (&hold->elem);
+          list_remove (&hold->thread_elem);
+          hold->rwlock = NULL;
+          hold->thread = NULL;
+          if (!thread_mlfqs)
+            t->priority = get_priority_among_locks_holding (t);
+          return hold;
+        }
+    }
+  return NULL;
+}
+
+/* Frees HOLD, from rwlock_remove_holder(), if it came from the
+   heap rather than being built into the current thread. */
+static void
+rwlock_free_hold (struct rwlock_hold *hold)
+{
+  struct thread *cur = thread_current ();
+
+  if (hold != NULL
+      && (hold < cur->rwlock_holds
+          || hold >= cur->rwlock_holds + RWLOCK_HOLD_MAX))
+    free (hold);
+}
+
+/* Wakes the first thread waiting on SEMA, one of an rwlock's
+   queues, and returns it, without changing SEMA's value or
+   yielding.  SEMA must have waiters.  Interrupts must be off. */
+static struct thread *
+sema_wake (struct semaphore *sema)
+{
+  struct thread *t;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  t = heap_entry (heap_pop (&sema->waiters), struct thread, waiter_elem);
+  t->sema_waiting = NULL;
+  thread_unblock (t);
+  return t;
+}
+
 /* One semaphore in a list. */
 struct semaphore_elem
   {
     struct thread *t;
-    struct list_elem elem;              /* List element. */
+    struct heap_elem elem;              /* Heap element. */
+    unsigned wait_seq;                  /* Order of arrival. */
     struct semaphore semaphore;         /* This semaphore. */
   };
 
+static void cond_enqueue (struct condition *, struct semaphore_elem *);
+static void cond_dequeue (struct condition *, struct semaphore_elem *);
+
 /* Initializes condition variable COND.  A condition variable
    allows one piece of code to signal a condition and cooperating
    code to receive the signal and act upon it. */
@@ -328,7 +775,7 @@ cond_init (struct condition *cond)
 {
   ASSERT (cond != NULL);
 
-  list_init (&cond->waiters);
+  heap_init (&cond->waiters, cond_waiter_less, NULL);
 }
 
 /* Atomically releases LOCK and waits for COND to be signaled by
@@ -362,13 +809,46 @@ cond_wait (struct condition *cond, struct lock *lock)
   ASSERT (lock_held_by_current_thread (lock));
 
   sema_init (&waiter.semaphore, 0);
-  waiter.t = thread_current();
-  list_push_back (&cond->waiters, &waiter.elem);
+  cond_enqueue (cond, &waiter);
   lock_release (lock);
   sema_down (&waiter.semaphore);
   lock_acquire (lock);
 }
 
+/* Like cond_wait(), but gives up waiting after TICKS timer
+   ticks.  LOCK is reacquired before returning either way.
+   Returns true if COND was signaled, false if the wait timed
+   out. */
+bool
+cond_wait_timeout (struct condition *cond, struct lock *lock, int64_t ticks)
+{
+  struct semaphore_elem waiter;
+  bool signaled;
+
+  ASSERT (cond != NULL);
+  ASSERT (lock != NULL);
+  ASSERT (!intr_context ());
+  ASSERT (lock_held_by_current_thread (lock));
+
+  sema_init (&waiter.semaphore, 0);
+  cond_enqueue (cond, &waiter);
+  lock_release (lock);
+  signaled = sema_down_timeout (&waiter.semaphore, ticks);
+  lock_acquire (lock);
+
+  /* A signal may have raced with the timeout.  cond_signal()
+     removes its waiter under LOCK, so now that we hold LOCK again
+     the semaphore's value tells us which happened. */
+  if (!signaled)
+    {
+      if (sema_try_down (&waiter.semaphore))
+        signaled = true;
+      else
+        cond_dequeue (cond, &waiter);
+    }
+  return signaled;
+}
+
 /* If any threads are waiting on COND (protected by LOCK), then
    this function signals one of them to wake up from its wait.
    LOCK must be held before calling this function.
@@ -384,11 +864,12 @@ cond_signal (struct condition *cond, struct lock *lock UNUSED)
   ASSERT (!intr_context ());
   ASSERT (lock_held_by_current_thread (lock));
 
-  if (!list_empty (&cond->waiters))
+  if (!heap_empty (&cond->waiters))
   {
-    list_sort(&cond->waiters, (list_less_func *) waiters_cmp_priority, NULL);
-    sema_up (&list_entry (list_pop_front (&cond->waiters),
-                          struct semaphore_elem, elem)->semaphore);
+    struct semaphore_elem *waiter = heap_entry (heap_top (&cond->waiters),
+                                                struct semaphore_elem, elem);
+    cond_dequeue (cond, waiter);
+    sema_up (&waiter->semaphore);
   }
 }
 
@@ -404,36 +885,111 @@ cond_broadcast (struct condition *cond, struct lock *lock)
   ASSERT (cond != NULL);
   ASSERT (lock != NULL);
 
-  while (!list_empty (&cond->waiters))
+  while (!heap_empty (&cond->waiters))
     cond_signal (cond, lock);
 }
 
-/* use to sort &cond->waiters */
-bool waiters_cmp_priority (const struct list_elem *a, const struct list_elem *b, void *aux UNUSED)
+/* Adds WAITER, for the running thread, to COND's waiters.  The
+   waiters are also reordered by donations, from other threads,
+   so they are only touched with interrupts off. */
+static void
+cond_enqueue (struct condition *cond, struct semaphore_elem *waiter)
+{
+  struct thread *cur = thread_current ();
+  enum intr_level old_level = intr_disable ();
+
+  waiter->t = cur;
+  waiter->wait_seq = next_wait_seq++;
+  cur->cond_waiting = cond;
+  cur->cond_elem = &waiter->elem;
+  heap_push (&cond->waiters, &waiter->elem);
+  intr_set_level (old_level);
+}
+
+/* Removes WAITER from COND's waiters. */
+static void
+cond_dequeue (struct condition *cond, struct semaphore_elem *waiter)
+{
+  enum intr_level old_level = intr_disable ();
+
+  heap_remove (&cond->waiters, &waiter->elem);
+  waiter->t->cond_waiting = NULL;
+  waiter->t->cond_elem = NULL;
+  intr_set_level (old_level);
+}
+
+/* Adds T to SEMA's waiters.  Interrupts must be off. */
+static void
+sema_enqueue (struct semaphore *sema, struct thread *t)
 {
-  struct thread *athread;
-  struct thread *bthread;
-  athread = list_entry(a, struct semaphore_elem, elem)->t;
-  bthread = list_entry(b, struct semaphore_elem, elem)->t;
-  return  athread->priority > bthread->priority;
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  t->wait_seq = next_wait_seq++;
+  t->sema_waiting = sema;
+  heap_push (&sema->waiters, &t->waiter_elem);
+}
+
+/* Called with interrupts off when T's priority has changed, to
+   restore the order of every waiter heap that T is in: the
+   semaphore it is blocked on, the lock it is acquiring, and the
+   condition it is waiting on.  Each is O(log n). */
+void
+synch_priority_changed (struct thread *t)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (t->sema_waiting != NULL)
+    heap_update (&t->sema_waiting->waiters, &t->waiter_elem);
+  if (t->lock_waiting != NULL && !thread_mlfqs)
+    heap_update (&t->lock_waiting->threads_waiting, &t->loc_elem);
+  if (t->cond_waiting != NULL)
+    heap_update (&t->cond_waiting->waiters, t->cond_elem);
+}
+
+/* Orders threads waiting on a semaphore by priority, then by
+   arrival. */
+static bool
+sema_waiter_less (const struct heap_elem *a_, const struct heap_elem *b_,
+                  void *aux UNUSED)
+{
+  const struct thread *a = heap_entry (a_, struct thread, waiter_elem);
+  const struct thread *b = heap_entry (b_, struct thread, waiter_elem);
+
+  if (a->priority != b->priority)
+    return a->priority < b->priority;
+  return a->wait_seq > b->wait_seq;
+}
+
+/* Orders threads acquiring a lock by priority.  Only the greatest
+   matters, as the lock's max_priority. */
+static bool
+lock_waiter_less (const struct heap_elem *a, const struct heap_elem *b,
+                  void *aux UNUSED)
+{
+  return (heap_entry (a, struct thread, loc_elem)->priority
+          < heap_entry (b, struct thread, loc_elem)->priority);
+}
+
+/* Orders condition waiters by their thread's priority, then by
+   arrival. */
+static bool
+cond_waiter_less (const struct heap_elem *a_, const struct heap_elem *b_,
+                  void *aux UNUSED)
+{
+  const struct semaphore_elem *a = heap_entry (a_, struct semaphore_elem, elem);
+  const struct semaphore_elem *b = heap_entry (b_, struct semaphore_elem, elem);
+
+  if (a->t->priority != b->t->priority)
+    return a->t->priority < b->t->priority;
+  return a->wait_seq > b->wait_seq;
 }
 
 
 int lock_get_max_priority(struct lock * lock)
 {
-  int p = PRI_MIN;
-  if (list_empty(&lock->threads_waiting))
-  {
-    return p;
-  }
-  struct list_elem* iter;
-  for(iter = list_begin(&lock->threads_waiting);iter != list_end(&lock->threads_waiting);iter = list_next(iter))
+  if (heap_empty(&lock->threads_waiting))
   {
-    struct thread* t = list_entry(iter, struct thread,loc_elem);
-    if (p < t->priority)
-    {
-      p = t->priority;
-    }
+    return PRI_MIN;
   }
-  return p;
+  return heap_entry(heap_top(&lock->threads_waiting), struct thread, loc_elem)->priority;
 }
\ No newline at end of file
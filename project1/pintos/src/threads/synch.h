@@ -1,19 +1,25 @@
 #ifndef THREADS_SYNCH_H
 #define THREADS_SYNCH_H
 
+#include <heap.h>
 #include <list.h>
 #include <stdbool.h>
+#include <stdint.h>
+
+struct thread;
 
 /* A counting semaphore. */
 struct semaphore
   {
     unsigned value;             /* Current value. */
-    struct list waiters;        /* List of waiting threads. */
+    struct heap waiters;        /* Waiting threads, highest priority
+                                   first, then first come first. */
   };
 
 void sema_init (struct semaphore *, unsigned value);
 void sema_down (struct semaphore *);
 bool sema_try_down (struct semaphore *);
+bool sema_down_timeout (struct semaphore *, int64_t ticks);
 void sema_up (struct semaphore *);
 void sema_self_test (void);
 
@@ -22,7 +28,7 @@ struct lock
   {
     struct thread *holder;      /* Thread holding lock (for debugging). */
     struct semaphore semaphore; /* Binary semaphore controlling access. */
-    struct list threads_waiting; /* threads that are currently waiting for this lock */
+    struct heap threads_waiting; /* threads that are currently waiting for this lock, by priority */
     struct list_elem loc_elem; /* list elem for locks_holding */
     int max_priority; /* max priority among threads_waiting*/
   };
@@ -33,14 +39,56 @@ bool lock_try_acquire (struct lock *);
 void lock_release (struct lock *);
 bool lock_held_by_current_thread (const struct lock *);
 
+/* Readers-writer lock.  Any number of threads may hold it shared,
+   for reading, or a single thread exclusive, for writing.  Once a
+   writer is waiting, new readers wait behind it.  Like a lock, it
+   is not recursive, and threads waiting on it donate their
+   priority to every thread holding it. */
+struct rwlock
+  {
+    int readers;                /* Threads holding it shared. */
+    struct thread *writer;      /* Thread holding it exclusive, or null. */
+    int readers_waiting;        /* Threads waiting to read... */
+    int writers_waiting;        /* ...and to write. */
+    struct semaphore read_queue;  /* Waiting readers block here... */
+    struct semaphore write_queue; /* ...and waiting writers here.
+                                     Both stay at 0: they are only
+                                     ordered wait queues. */
+    struct list holders;        /* Holders' struct rwlock_holds. */
+  };
+
+/* An rwlock held by a thread.  Each thread has RWLOCK_HOLD_MAX
+   of these built in and takes more from the heap when it holds
+   more rwlocks than that at once. */
+#define RWLOCK_HOLD_MAX 4
+struct rwlock_hold
+  {
+    struct rwlock *rwlock;      /* Held rwlock, or null if not yet. */
+    struct thread *thread;      /* Holding thread, or null if unused. */
+    struct list_elem elem;      /* Element in rwlock's holders. */
+    struct list_elem thread_elem; /* Element in thread's rwlocks_held. */
+  };
+
+void rwlock_init (struct rwlock *);
+void rwlock_acquire_read (struct rwlock *);
+void rwlock_release_read (struct rwlock *);
+void rwlock_acquire_write (struct rwlock *);
+void rwlock_release_write (struct rwlock *);
+bool rwlock_held_for_write (const struct rwlock *);
+
+void rwlock_donate (struct rwlock *, struct thread *);
+int rwlock_get_max_priority (struct rwlock *);
+
 /* Condition variable. */
 struct condition
   {
-    struct list waiters;        /* List of waiting threads. */
+    struct heap waiters;        /* Waiting threads, highest priority
+                                   first, then first come first. */
   };
 
 void cond_init (struct condition *);
 void cond_wait (struct condition *, struct lock *);
+bool cond_wait_timeout (struct condition *, struct lock *, int64_t ticks);
 void cond_signal (struct condition *, struct lock *);
 void cond_broadcast (struct condition *, struct lock *);
 
@@ -48,6 +96,8 @@ void cond_broadcast (struct condition *, struct lock *);
 
 int lock_get_max_priority(struct lock * lock);
 
+void synch_priority_changed (struct thread *);
+
 /* Optimization barrier.
 
    The compiler will not reorder operations across an
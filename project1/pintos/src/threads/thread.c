@@ -2,6 +2,7 @@
 #include <debug.h>
 #include <stddef.h>
 #include <random.h>
+#include <round.h>
 #include <stdio.h>
 #include <string.h>
 #include "threads/flags.h"
@@ -10,7 +11,9 @@
 #include "threads/palloc.h"
 #include "threads/switch.h"
 #include "threads/synch.h"
+#include "threads/tsc.h"
 #include "threads/vaddr.h"
+#include "threads/workqueue.h"
 #include "threads/fixed-point.h"
 #include "devices/timer.h"
 #ifdef USERPROG
@@ -22,26 +25,36 @@
    of thread.h for details. */
 #define THREAD_MAGIC 0xcd6abf4b
 
-/* List of processes in THREAD_READY state, that is, processes
-   that are ready to run but not actually running. */
-static struct list ready_list;
+/* Number of distinct priorities, and so of run queues. */
+#define PRI_CNT (PRI_MAX - PRI_MIN + 1)
+
+/* Processes in THREAD_READY state, that is, processes that are
+   ready to run but not actually running.  There is one FIFO
+   queue per priority; bit P of ready_bitmap is set whenever
+   ready_queues[P - PRI_MIN] is nonempty, so the highest ready
+   priority is found with a single bit scan. */
+static struct list ready_queues[PRI_CNT];
+static uint64_t ready_bitmap;
+static int ready_cnt;           /* Threads on all ready queues. */
 
 /* List of all processes.  Processes are added to this list
    when they are first scheduled and removed when they exit. */
 static struct list all_list;
 
-/* List of the processes that are corrently sleeping. Processes are 
-   added to the list when they call timer_sleep. The list should be ordered by when the process should wake up*/
-static struct list sleeping_list;
-
 /* Idle thread. */
 static struct thread *idle_thread;
 
 /* Initial thread, the thread running init.c:main(). */
 static struct thread *initial_thread;
 
-/* Lock used by allocate_tid(). */
-static struct lock tid_lock;
+/* Pages of exited threads, kept for thread_create() to reuse
+   without going back to the page allocator.  A recycled page is
+   not zeroed: init_thread() clears the struct thread at its
+   bottom, and the stack above is written before it is read.
+   thread_cache_release() gives them back when memory runs low. */
+#define THREAD_CACHE_MAX 16
+static struct thread *thread_cache[THREAD_CACHE_MAX];
+static int thread_cache_cnt;
 
 //static struct lock load_avg_update_lock;
 
@@ -66,11 +79,57 @@ static long long user_ticks;    /* # of timer ticks in user programs. */
 #define TIME_SLICE 4            /* # of timer ticks to give each thread. */
 static unsigned thread_ticks;   /* # of timer ticks since last yield. */
 
+/* Scheduling statistics. */
+static uint64_t boot_tsc;       /* TSC at thread_init(). */
+static bool preempting;         /* Set by thread_preempt() for schedule(). */
+
 /* If false (default), use round-robin scheduler.
    If true, use multi-level feedback queue scheduler.
    Controlled by kernel command-line option "-o mlfqs". */
 bool thread_mlfqs;
 
+/* If true, use stride scheduler.
+   Controlled by kernel command-line option "-stride". */
+bool thread_stride;
+
+/* Stride scheduling.  A thread's stride is STRIDE1 / tickets.
+   Each tick it runs adds its stride to its pass, and the ready
+   thread with the lowest pass runs next.  global_pass follows
+   the lowest pass of any runnable thread: a thread that blocks
+   remembers only how far ahead of it it was, and wakes up that
+   far ahead again, so sleeping neither earns nor costs it CPU
+   time. */
+#define STRIDE1 (1 << 20)
+static struct heap stride_queue;                 /* Ready threads, by pass. */
+static uint64_t global_pass;
+
+/* Real-time class.  A thread enrolled with thread_set_realtime()
+   reserves BUDGET ticks of every PERIOD ticks, and must use them
+   by the end of the period, its deadline.  Ready real-time
+   threads run ahead of all others, earliest deadline first,
+   which meets every deadline as long as the reservations add up
+   to no more than the whole CPU.  Admission control keeps them
+   to RT_UTIL_MAX, leaving the rest for ordinary threads.  A
+   thread that uses up its budget is parked until its next
+   period begins. */
+#define RT_UTIL_SCALE 1000                       /* Whole CPU. */
+#define RT_UTIL_MAX 900                          /* Most reservable. */
+static struct heap rt_queue;                     /* Ready threads, by deadline. */
+static int rt_util;                              /* Reserved, of RT_UTIL_SCALE. */
+
+/* MLFQS recent_cpu decay.  Once a second the timer interrupt only
+   updates load_avg and records the decay coefficient
+   (2*load_avg)/(2*load_avg + 1) for that second; each thread's
+   recent_cpu catches up on the seconds it missed whenever it is
+   next looked at (mlfqs_catch_up()).  The mlfqs_sweep work item
+   then brings every thread up to date, and recomputes its
+   priority, outside interrupt context, so no thread falls more
+   than DECAY_HISTORY seconds behind. */
+#define DECAY_HISTORY 16
+static int mlfqs_epoch;                          /* Seconds since boot. */
+static fixed_point_t decay_coef[DECAY_HISTORY];  /* Coefficient of each recent second. */
+static struct work mlfqs_sweep_work;
+
 static void kernel_thread (thread_func *, void *aux);
 
 static void idle (void *aux UNUSED);
@@ -82,14 +141,23 @@ static void *alloc_frame (struct thread *, size_t size);
 static void schedule (void);
 void thread_schedule_tail (struct thread *prev);
 static tid_t allocate_tid (void);
+static void ready_queue_push (struct thread *);
+static void ready_queue_remove (struct thread *);
+static int ready_max_priority (void);
+static bool stride_less (const struct heap_elem *, const struct heap_elem *,
+                         void *aux);
+static void stride_advance (struct thread *cur);
+static bool rt_less (const struct heap_elem *, const struct heap_elem *,
+                     void *aux);
+static void rt_leave (struct thread *);
+static void thread_change_priority (struct thread *, int priority);
 
 void count_number_ready_or_running(struct thread*, void*);
 
-void thread_update_recent_cpu(struct thread*, void* aux UNUSED);
-void thread_update_recent_cpu_all(void);
+static void mlfqs_catch_up (struct thread *);
+static void mlfqs_sweep (struct work *, void *aux UNUSED);
 
 void update_priority_mlfqs(struct thread*, void* aux UNUSED);
-void update_priority_mlfqs_all(void);
 
 void thread_update_load_avg(void);
 
@@ -100,7 +168,7 @@ int calculate_new_priority_mlfqs(fixed_point_t, int);
    general and it is possible in this case only because loader.S
    was careful to put the bottom of the stack at a page boundary.
 
-   Also initializes the run queue and the tid lock.
+   Also initializes the run queues.
 
    After calling this function, be sure to initialize the page
    allocator before trying to create any threads with
@@ -111,18 +179,23 @@ int calculate_new_priority_mlfqs(fixed_point_t, int);
 void
 thread_init (void)
 {
+  int i;
+
   ASSERT (intr_get_level () == INTR_OFF);
   load_avg = fix_int(0);
 
-  lock_init (&tid_lock);
-
   //lock_init(&load_avg_update_lock);
   //lock_init(&recent_cpu_update_lock);
   //lock_init(&mlfqs_priority_update_lock);
 
-  list_init (&ready_list);
+  for (i = 0; i < PRI_CNT; i++)
+    list_init (&ready_queues[i]);
+  ready_bitmap = 0;
+  ready_cnt = 0;
+  heap_init (&stride_queue, stride_less, NULL);
+  heap_init (&rt_queue, rt_less, NULL);
   list_init (&all_list);
-  list_init(&sleeping_list);
+  boot_tsc = rdtsc ();
 
   /* Set up a thread structure for the running thread. */
   initial_thread = running_thread ();
@@ -146,6 +219,9 @@ thread_start (void)
 
   /* Wait for the idle thread to initialize idle_thread. */
   sema_down (&idle_started);
+
+  work_init (&mlfqs_sweep_work, mlfqs_sweep, NULL, WORK_HIGH);
+  workqueue_init ();
 }
 
 /* Called by the timer interrupt handler at each timer tick.
@@ -168,22 +244,58 @@ thread_tick (void)
   else {
     kernel_ticks++;
   }
-  if (thread_current() != idle_thread && thread_mlfqs)
+  if (thread_mlfqs)
   {
-    t->recent_cpu = fix_add(t->recent_cpu, fix_int(1));
-  }
-  if (timer_ticks() % TIMER_FREQ == 0 && thread_mlfqs) {
-    thread_update_load_avg();
-    thread_update_recent_cpu_all();
-  }
+    /* Everything here is O(1): only the running thread's
+       recent_cpu grows, so only its priority needs recomputing
+       every 4 ticks, and the per-second decay of everyone else
+       is left to mlfqs_catch_up() and mlfqs_sweep(). */
+    mlfqs_catch_up(t);
+    if (t != idle_thread)
+    {
+      t->recent_cpu = fix_add(t->recent_cpu, fix_int(1));
+    }
+    if (timer_ticks() % TIMER_FREQ == 0) {
+      fixed_point_t twoLA;
+
+      thread_update_load_avg();
+      twoLA = fix_mul(fix_int(2), load_avg);
+      decay_coef[mlfqs_epoch % DECAY_HISTORY] = fix_div(twoLA, fix_add(twoLA, fix_int(1)));
+      mlfqs_epoch++;
+      mlfqs_catch_up(t);
 
-  if (timer_ticks() % 4 == 0 && thread_mlfqs) {
-     update_priority_mlfqs_all();
+      work_schedule(&mlfqs_sweep_work);
+    }
+    if (timer_ticks() % 4 == 0) {
+      update_priority_mlfqs(t, NULL);
+    }
   }
 
 
  /* Enforce preemption. */
-  if (++thread_ticks >= TIME_SLICE) {
+  if (thread_stride && t != idle_thread)
+  {
+    t->pass += STRIDE1 / t->tickets;
+    stride_advance (t);
+  }
+
+  /* Enforce real-time budgets, and let a ready real-time thread
+     with an earlier deadline than ours, or any at all if we are
+     not real-time, take over. */
+  if (t->rt && ++t->rt_used >= t->rt_budget)
+  {
+    t->rt_throttled = true;
+    if (intr_context ())
+      intr_yield_on_return ();
+  }
+  if (!heap_empty (&rt_queue) && intr_context ())
+  {
+    struct thread *r = heap_entry (heap_top (&rt_queue), struct thread, rt_elem);
+    if (!t->rt || r->rt_deadline < t->rt_deadline)
+      intr_yield_on_return ();
+  }
+
+  if (++thread_ticks >= TIME_SLICE && intr_context ()) {
     intr_yield_on_return ();
   }
 }
@@ -192,8 +304,63 @@ thread_tick (void)
 void
 thread_print_stats (void)
 {
+  uint64_t cycles_per_ms;
+  struct list_elem *e;
+
   printf ("Thread: %lld idle ticks, %lld kernel ticks, %lld user ticks\n",
           idle_ticks, kernel_ticks, user_ticks);
+
+  /* Calibrate the TSC against the timer. */
+  cycles_per_ms = (rdtsc () - boot_tsc) * TIMER_FREQ / 1000
+                  / (timer_ticks () > 0 ? timer_ticks () : 1);
+  if (cycles_per_ms == 0)
+    cycles_per_ms = 1;
+
+  printf ("Thread scheduling (ms run/ready/max wait, switches in, "
+          "voluntary/involuntary/preempted out):\n");
+  for (e = list_begin (&all_list); e != list_end (&all_list);
+       e = list_next (e))
+    {
+      struct thread *t = list_entry (e, struct thread, allelem);
+      const struct thread_stats *s = &t->stats;
+
+      printf ("  %5d %-16s %llu/%llu/%llu, %u, %u/%u/%u\n",
+              t->tid, t->name,
+              s->run_cycles / cycles_per_ms,
+              s->ready_cycles / cycles_per_ms,
+              s->max_ready_cycles / cycles_per_ms,
+              s->dispatch_cnt, s->voluntary_cnt, s->involuntary_cnt,
+              s->preempt_cnt);
+    }
+}
+
+/* Copies the scheduling statistics of the thread with the given
+   TID into *STATS.  The running thread's include its current
+   time slice so far.  Returns false if there is no such thread. */
+bool
+thread_get_stats (tid_t tid, struct thread_stats *stats)
+{
+  struct list_elem *e;
+  enum intr_level old_level;
+  bool found = false;
+
+  old_level = intr_disable ();
+  for (e = list_begin (&all_list); e != list_end (&all_list);
+       e = list_next (e))
+    {
+      struct thread *t = list_entry (e, struct thread, allelem);
+
+      if (t->tid == tid)
+        {
+          *stats = t->stats;
+          if (t == thread_current ())
+            stats->run_cycles += rdtsc () - t->stats_stamp;
+          found = true;
+          break;
+        }
+    }
+  intr_set_level (old_level);
+  return found;
 }
 
 /* Creates a new kernel thread named NAME with the given initial
@@ -219,12 +386,17 @@ thread_create (const char *name, int priority,
   struct kernel_thread_frame *kf;
   struct switch_entry_frame *ef;
   struct switch_threads_frame *sf;
+  enum intr_level old_level;
   tid_t tid;
 
   ASSERT (function != NULL);
 
-  /* Allocate thread. */
-  t = palloc_get_page (PAL_ZERO);
+  /* Allocate thread, preferably recycling an exited one's page. */
+  old_level = intr_disable ();
+  t = thread_cache_cnt > 0 ? thread_cache[--thread_cache_cnt] : NULL;
+  intr_set_level (old_level);
+  if (t == NULL)
+    t = palloc_get_page (PAL_ZERO);
   if (t == NULL)
     return TID_ERROR;
 
@@ -266,10 +438,14 @@ thread_create (const char *name, int priority,
 void
 thread_block (void)
 {
+  struct thread *cur = thread_current ();
+
   ASSERT (!intr_context ());
   ASSERT (intr_get_level () == INTR_OFF);
 
-  thread_current ()->status = THREAD_BLOCKED;
+  if (thread_stride)
+    cur->pass_remain = cur->pass > global_pass ? cur->pass - global_pass : 0;
+  cur->status = THREAD_BLOCKED;
   schedule ();
 }
 
@@ -290,11 +466,42 @@ thread_unblock (struct thread *t)
 
   old_level = intr_disable ();
   ASSERT (t->status == THREAD_BLOCKED);
-  list_insert_ordered (&ready_list, &t->elem, (list_less_func *) &thread_cmp_priority, NULL);
+  if (thread_mlfqs && t != idle_thread)
+  {
+    /* It may have slept through a few decays. */
+    mlfqs_catch_up (t);
+    t->priority = calculate_new_priority_mlfqs (t->recent_cpu, t->nice);
+  }
+  if (thread_stride)
+  {
+    stride_advance (running_thread ());
+    t->pass = global_pass + t->pass_remain;
+  }
+  ready_queue_push (t);
   t->status = THREAD_READY;
+  t->stats_stamp = rdtsc ();
   intr_set_level (old_level);
 }
 
+/* Returns true if ready thread T would be scheduled ahead of the
+   running thread, so that whoever woke T should yield to it.
+   Interrupts must be off. */
+bool
+thread_outranks_current (const struct thread *t)
+{
+  struct thread *cur = running_thread ();
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (cur == idle_thread)
+    return true;
+  if (t->rt || cur->rt)
+    return t->rt && (!cur->rt || t->rt_deadline < cur->rt_deadline);
+  if (thread_stride)
+    return t->pass < cur->pass;
+  return t->priority > cur->priority;
+}
+
 /* Returns the name of the running thread. */
 const char *
 thread_name (void)
@@ -343,6 +550,8 @@ thread_exit (void)
      and schedule another process.  That process will destroy us
      when it calls thread_schedule_tail(). */
   intr_disable ();
+  if (thread_current ()->rt)
+    rt_leave (thread_current ());
   list_remove (&thread_current()->allelem);
   thread_current ()->status = THREAD_DYING;
   schedule ();
@@ -360,13 +569,30 @@ thread_yield (void)
   ASSERT (!intr_context ());
 
   old_level = intr_disable ();
-  if (cur != idle_thread)
-    list_insert_ordered (&ready_list, &cur->elem, (list_less_func *) &thread_cmp_priority, NULL);
-  cur->status = THREAD_READY;
+  if (cur->rt_throttled)
+    cur->status = THREAD_BLOCKED;       /* Until rt_replenish(). */
+  else
+  {
+    if (cur != idle_thread)
+      ready_queue_push (cur);
+    cur->status = THREAD_READY;
+  }
   schedule ();
   intr_set_level (old_level);
 }
 
+/* Yields the CPU on behalf of an interrupt handler that asked
+   for it with intr_yield_on_return(), which counts as preempting
+   the running thread. */
+void
+thread_preempt (void)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  preempting = true;
+  thread_yield ();
+}
+
 /* Invoke function 'func' on all threads, passing along 'aux'.
    This function must be called with interrupts off. */
 void
@@ -437,13 +663,43 @@ void
 update_priority_mlfqs(struct thread* t, void* aux UNUSED) {
   if (t != idle_thread)
   {
-    t->priority = calculate_new_priority_mlfqs(t->recent_cpu, t->nice);
+    mlfqs_catch_up(t);
+    thread_change_priority(t, calculate_new_priority_mlfqs(t->recent_cpu, t->nice));
   }
 }
 
-void
-update_priority_mlfqs_all(void) {
+/* Applies to T's recent_cpu the once-a-second decay
+   recent_cpu = coef * recent_cpu + nice for every second since it
+   was last brought up to date.  Interrupts must be off. */
+static void
+mlfqs_catch_up (struct thread *t)
+{
+  int epoch = t->recent_cpu_epoch;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  /* mlfqs_sweep() keeps this from happening, but if a thread did
+     fall further behind, the oldest decays are simply lost. */
+  if (mlfqs_epoch - epoch > DECAY_HISTORY)
+    epoch = mlfqs_epoch - DECAY_HISTORY;
+
+  if (t != idle_thread)
+    for (; epoch < mlfqs_epoch; epoch++)
+      t->recent_cpu = fix_add(fix_mul(decay_coef[epoch % DECAY_HISTORY], t->recent_cpu),
+                              fix_int(t->nice));
+  t->recent_cpu_epoch = mlfqs_epoch;
+}
+
+/* MLFQS sweep.  Scheduled by thread_tick() once a second, on
+   the high-priority work queue so it runs ahead of every other
+   thread as the per-second update did from the timer interrupt,
+   and brings every thread's recent_cpu and priority up to date. */
+static void
+mlfqs_sweep (struct work *w UNUSED, void *aux UNUSED)
+{
+  enum intr_level old_level = intr_disable();
   thread_foreach(update_priority_mlfqs, NULL);
+  intr_set_level(old_level);
 }
 
 
@@ -454,6 +710,114 @@ thread_get_priority (void)
   return thread_current ()->priority;
 }
 
+/* Starts real-time thread T's next period, with a fresh budget,
+   from the timer interrupt, and unparks T if it had run out. */
+static void
+rt_replenish (struct timeout *to, void *t_)
+{
+  struct thread *t = t_;
+
+  t->rt_used = 0;
+  t->rt_deadline += t->rt_period;
+  if (t->status == THREAD_READY)
+    heap_update (&rt_queue, &t->rt_elem);   /* rt_deadline is its key. */
+  timeout_add (to, t->rt_deadline, rt_replenish, t);
+  if (t->rt_throttled)
+  {
+    t->rt_throttled = false;
+    if (t->status == THREAD_BLOCKED)
+      thread_unblock (t);
+  }
+}
+
+/* Returns the share of the CPU, out of RT_UTIL_SCALE, that a
+   reservation of BUDGET ticks in every PERIOD takes. */
+static int
+rt_share (int64_t budget, int64_t period)
+{
+  return DIV_ROUND_UP (budget * RT_UTIL_SCALE, period);
+}
+
+/* Takes T, which must be the running thread, out of the
+   real-time class.  Interrupts must be off. */
+static void
+rt_leave (struct thread *t)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  timeout_cancel (&t->rt_timeout);
+  rt_util -= rt_share (t->rt_budget, t->rt_period);
+  t->rt = t->rt_throttled = false;
+}
+
+/* Enrols the current thread in the real-time class with a
+   reservation of BUDGET ticks in every PERIOD ticks, or, if
+   PERIOD is 0, takes it out of the class.  Returns false if the
+   reservation is invalid or admitting it would reserve more than
+   RT_UTIL_MAX of the CPU, in which case any earlier reservation
+   stands. */
+bool
+thread_set_realtime (int period, int budget)
+{
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+  int share;
+  bool ok = true;
+
+  if (period == 0)
+  {
+    old_level = intr_disable ();
+    if (cur->rt)
+      rt_leave (cur);
+    intr_set_level (old_level);
+    return true;
+  }
+  if (period < 0 || budget <= 0 || budget > period)
+    return false;
+
+  share = rt_share (budget, period);
+  old_level = intr_disable ();
+  if (cur->rt)
+    share -= rt_share (cur->rt_budget, cur->rt_period);
+  if (rt_util + share > RT_UTIL_MAX)
+    ok = false;
+  else
+  {
+    if (cur->rt)
+      rt_leave (cur);
+    rt_util += rt_share (budget, period);
+    cur->rt = true;
+    cur->rt_period = period;
+    cur->rt_budget = budget;
+    cur->rt_used = 0;
+    cur->rt_deadline = timer_ticks () + period;
+    timeout_add (&cur->rt_timeout, cur->rt_deadline, rt_replenish, cur);
+  }
+  intr_set_level (old_level);
+  return ok;
+}
+
+/* Returns the current thread's stride scheduler tickets. */
+int
+thread_get_tickets (void)
+{
+  return thread_current ()->tickets;
+}
+
+/* Gives the current thread TICKETS tickets, which must be
+   between TICKETS_MIN and TICKETS_MAX, as its share of the CPU
+   under the stride scheduler.  Threads it creates, including
+   processes it executes, inherit them.  Returns false if TICKETS
+   is out of range. */
+bool
+thread_set_tickets (int tickets)
+{
+  if (tickets < TICKETS_MIN || tickets > TICKETS_MAX)
+    return false;
+  thread_current ()->tickets = tickets;
+  return true;
+}
+
 /* Sets the current thread's nice value to NICE. */
 void
 thread_set_nice (int new_nice)
@@ -461,15 +825,16 @@ thread_set_nice (int new_nice)
    enum intr_level old_level;
    old_level = intr_disable();
 
+   mlfqs_catch_up(thread_current());
    thread_current ()->nice = new_nice;
    int newPriority = calculate_new_priority_mlfqs(thread_current()->recent_cpu, new_nice);
    //Cannot call thread_set_priority here, as it will be ignored when mlfqs is active
    thread_current ()->priority = newPriority;
 
+   bool preempt = ready_max_priority() > newPriority;
    intr_set_level(old_level);
 
-   struct thread* potentialNextThread = list_entry(list_head(&ready_list), struct thread, elem);
-   if (potentialNextThread != NULL && potentialNextThread->priority > newPriority) {
+   if (preempt) {
        thread_yield();
    }
 }
@@ -491,7 +856,7 @@ thread_get_load_avg (void)
 void
 thread_update_load_avg (void)
 {
-   int num_ready_threads = list_size(&ready_list);
+   int num_ready_threads = ready_cnt;
    if (thread_current() != idle_thread)
    {
      num_ready_threads++;
@@ -509,29 +874,11 @@ thread_update_load_avg (void)
 int
 thread_get_recent_cpu (void)
 {
-    return fix_round(fix_mul(fix_int(100), thread_current()->recent_cpu));
-}
-
-void
-thread_update_recent_cpu(struct thread* thr, void* aux UNUSED)
-{
-  if (thr == idle_thread)
-  {
-    return;
-  }
-  fixed_point_t twoLA = fix_mul(fix_int(2), load_avg);
-  fixed_point_t twoLAplus = fix_add(twoLA, fix_int(1));
-  fixed_point_t LAFrac = fix_div(twoLA, twoLAplus);
-  fixed_point_t recent_cpu = thr->recent_cpu;
-  fixed_point_t nice_fixed = fix_int(thr->nice);
-  fixed_point_t product = fix_mul(LAFrac, recent_cpu);
-  fixed_point_t sum = fix_add(product, nice_fixed);
-  thr->recent_cpu = sum;
-}
-
-void
-thread_update_recent_cpu_all(void) {
-  thread_foreach(thread_update_recent_cpu, NULL);
+    enum intr_level old_level = intr_disable();
+    mlfqs_catch_up(thread_current());
+    int recent_cpu = fix_round(fix_mul(fix_int(100), thread_current()->recent_cpu));
+    intr_set_level(old_level);
+    return recent_cpu;
 }
 
 int
@@ -572,6 +919,10 @@ idle (void *idle_started_ UNUSED)
       intr_disable ();
       thread_block ();
 
+      /* Nothing is runnable: in tickless mode, stop the periodic
+         timer interrupt until the next timeout is due. */
+      timer_idle_enter ();
+
       /* Re-enable interrupts and wait for the next one.
 
          The `sti' instruction disables interrupts until the
@@ -647,19 +998,27 @@ init_thread (struct thread *t, const char *name, int priority)
     t->recent_cpu = fix_int(0);
   }
   else {
+    old_level = intr_disable ();
+    mlfqs_catch_up(thread_current());
+    intr_set_level (old_level);
     t->nice = thread_current() -> nice;
     t->recent_cpu = thread_current() -> recent_cpu;
+    t->recent_cpu_epoch = mlfqs_epoch;
 
     t->priority = calculate_new_priority_mlfqs(t->recent_cpu, t->nice);
     t->base_priority = t->priority;
   }
 
+  t->tickets = t != initial_thread ? thread_current ()->tickets
+                                    : TICKETS_DEFAULT;
   t->magic = THREAD_MAGIC;
+  t->stats_stamp = rdtsc ();
   t->ticks_wakeup = 0;
   t->lock_waiting = NULL;
 
   old_level = intr_disable ();
   list_init (&t->locks_holding);
+  list_init (&t->rwlocks_held);
   list_push_back (&all_list, &t->allelem);
   intr_set_level (old_level);
 }
@@ -685,10 +1044,168 @@ alloc_frame (struct thread *t, size_t size)
 static struct thread *
 next_thread_to_run (void)
 {
-  if (list_empty (&ready_list))
+  struct thread *t;
+
+  if (!heap_empty (&rt_queue))
+    {
+      t = heap_entry (heap_top (&rt_queue), struct thread, rt_elem);
+      ready_queue_remove (t);
+      return t;
+    }
+
+  if (thread_stride)
+    {
+      if (heap_empty (&stride_queue))
+        return idle_thread;
+      t = heap_entry (heap_top (&stride_queue), struct thread, stride_elem);
+      ready_queue_remove (t);
+      return t;
+    }
+
+  if (ready_bitmap == 0)
     return idle_thread;
+
+  t = list_entry (list_front (&ready_queues[ready_max_priority () - PRI_MIN]),
+                  struct thread, elem);
+  ready_queue_remove (t);
+  return t;
+}
+
+/* Appends ready thread T to the back of the run queue for its
+   current priority.  Interrupts must be off. */
+static void
+ready_queue_push (struct thread *t)
+{
+  int p = t->priority;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (PRI_MIN <= p && p <= PRI_MAX);
+
+  if (t->rt)
+    {
+      heap_push (&rt_queue, &t->rt_elem);
+      ready_cnt++;
+      return;
+    }
+  if (thread_stride)
+    {
+      heap_push (&stride_queue, &t->stride_elem);
+      ready_cnt++;
+      return;
+    }
+
+  list_push_back (&ready_queues[p - PRI_MIN], &t->elem);
+  ready_bitmap |= (uint64_t) 1 << (p - PRI_MIN);
+  ready_cnt++;
+}
+
+/* Removes T from the run queue for its current priority, which
+   must be the one it was pushed onto.  Interrupts must be off. */
+static void
+ready_queue_remove (struct thread *t)
+{
+  int p = t->priority;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (t->rt)
+    {
+      heap_remove (&rt_queue, &t->rt_elem);
+      ready_cnt--;
+      return;
+    }
+  if (thread_stride)
+    {
+      heap_remove (&stride_queue, &t->stride_elem);
+      ready_cnt--;
+      return;
+    }
+
+  list_remove (&t->elem);
+  if (list_empty (&ready_queues[p - PRI_MIN]))
+    ready_bitmap &= ~((uint64_t) 1 << (p - PRI_MIN));
+  ready_cnt--;
+}
+
+/* Sets T's effective priority to PRIORITY, moving T to the
+   matching run queue if it is ready, or reordering the waiters
+   of whatever it is blocked on.  Interrupts must be off. */
+static void
+thread_change_priority (struct thread *t, int priority)
+{
+  if (t->priority == priority)
+    return;
+
+  if (t->status == THREAD_READY)
+    {
+      ready_queue_remove (t);
+      t->priority = priority;
+      ready_queue_push (t);
+    }
   else
-    return list_entry (list_pop_front (&ready_list), struct thread, elem);
+    {
+      t->priority = priority;
+      synch_priority_changed (t);
+    }
+}
+
+/* Returns the highest priority of any ready thread, or -1 if
+   no thread is ready.  Interrupts must be off. */
+static int
+ready_max_priority (void)
+{
+  if (ready_bitmap == 0)
+    return -1;
+  return PRI_MIN + 63 - __builtin_clzll (ready_bitmap);
+}
+
+/* Orders ready threads for the stride scheduler: A is "less"
+   than B, and runs after it, if it has the higher pass. */
+static bool
+stride_less (const struct heap_elem *a_, const struct heap_elem *b_,
+             void *aux UNUSED)
+{
+  const struct thread *a = heap_entry (a_, struct thread, stride_elem);
+  const struct thread *b = heap_entry (b_, struct thread, stride_elem);
+
+  if (a->pass != b->pass)
+    return a->pass > b->pass;
+  return a->tid > b->tid;
+}
+
+/* Orders ready real-time threads: A is "less" than B, and runs
+   after it, if its deadline is later. */
+static bool
+rt_less (const struct heap_elem *a_, const struct heap_elem *b_,
+         void *aux UNUSED)
+{
+  const struct thread *a = heap_entry (a_, struct thread, rt_elem);
+  const struct thread *b = heap_entry (b_, struct thread, rt_elem);
+
+  if (a->rt_deadline != b->rt_deadline)
+    return a->rt_deadline > b->rt_deadline;
+  return a->tid > b->tid;
+}
+
+/* Advances global_pass to the lowest pass of the running thread
+   CUR, unless it is the idle thread, and the ready threads.
+   Interrupts must be off. */
+static void
+stride_advance (struct thread *cur)
+{
+  uint64_t low = UINT64_MAX;
+
+  if (cur != idle_thread && cur->status == THREAD_RUNNING)
+    low = cur->pass;
+  if (!heap_empty (&stride_queue))
+    {
+      struct thread *t = heap_entry (heap_top (&stride_queue),
+                                     struct thread, stride_elem);
+      if (t->pass < low)
+        low = t->pass;
+    }
+  if (low != UINT64_MAX && low > global_pass)
+    global_pass = low;
 }
 
 /* Completes a thread switch by activating the new thread's page
@@ -714,8 +1231,20 @@ thread_schedule_tail (struct thread *prev)
 
   ASSERT (intr_get_level () == INTR_OFF);
 
-  /* Mark us as running. */
+  /* Mark us as running, and charge the time we spent waiting for
+     that to our ready time. */
   cur->status = THREAD_RUNNING;
+  if (prev != NULL)
+    {
+      uint64_t now = rdtsc ();
+      uint64_t waited = now - cur->stats_stamp;
+
+      cur->stats.ready_cycles += waited;
+      if (waited > cur->stats.max_ready_cycles)
+        cur->stats.max_ready_cycles = waited;
+      cur->stats.dispatch_cnt++;
+      cur->stats_stamp = now;
+    }
 
   /* Start new time slice. */
   thread_ticks = 0;
@@ -733,7 +1262,36 @@ thread_schedule_tail (struct thread *prev)
   if (prev != NULL && prev->status == THREAD_DYING && prev != initial_thread)
     {
       ASSERT (prev != cur);
-      palloc_free_page (prev);
+      if (thread_cache_cnt < THREAD_CACHE_MAX)
+        {
+          /* Stale pointers to PREV must not pass is_thread(). */
+          prev->magic = 0;
+          thread_cache[thread_cache_cnt++] = prev;
+        }
+      else
+        palloc_free_page (prev);
+    }
+}
+
+/* Gives the pages that exited threads left for thread_create()
+   to reuse back to the page allocator.  Called by the page
+   allocator when the kernel pool runs out.  Returns the number
+   of pages given back. */
+size_t
+thread_cache_release (void)
+{
+  size_t cnt = 0;
+
+  for (;;)
+    {
+      enum intr_level old_level = intr_disable ();
+      struct thread *t = (thread_cache_cnt > 0
+                          ? thread_cache[--thread_cache_cnt] : NULL);
+      intr_set_level (old_level);
+      if (t == NULL)
+        return cnt;
+      palloc_free_page (t);
+      cnt++;
     }
 }
 
@@ -750,13 +1308,29 @@ schedule (void)
   struct thread *cur = running_thread ();
   struct thread *next = next_thread_to_run ();
   struct thread *prev = NULL;
+  bool preempted = preempting;
 
   ASSERT (intr_get_level () == INTR_OFF);
   ASSERT (cur->status != THREAD_RUNNING);
   ASSERT (is_thread (next));
 
+  preempting = false;
   if (cur != next)
-    prev = switch_threads (cur, next);
+    {
+      uint64_t now = rdtsc ();
+
+      cur->stats.run_cycles += now - cur->stats_stamp;
+      cur->stats_stamp = now;
+      if (cur->status == THREAD_READY)
+        {
+          cur->stats.involuntary_cnt++;
+          if (preempted)
+            cur->stats.preempt_cnt++;
+        }
+      else
+        cur->stats.voluntary_cnt++;
+      prev = switch_threads (cur, next);
+    }
   thread_schedule_tail (prev);
 }
 
@@ -765,11 +1339,14 @@ static tid_t
 allocate_tid (void)
 {
   static tid_t next_tid = 1;
+  enum intr_level old_level;
   tid_t tid;
 
-  lock_acquire (&tid_lock);
+  /* Far too short a critical section to be worth a lock, which
+     would cost two semaphore operations per thread created. */
+  old_level = intr_disable ();
   tid = next_tid++;
-  lock_release (&tid_lock);
+  intr_set_level (old_level);
 
   return tid;
 }
@@ -778,63 +1355,24 @@ allocate_tid (void)
    Used by switch.S, which can't figure it out on its own. */
 uint32_t thread_stack_ofs = offsetof (struct thread, stack);
 
-/* if ticks_wakeup <= ticks, unblock the thread */
-void
-wakeup_sleeping_thread (int64_t ticks)
-{
-  struct thread *t;
-  if (list_empty (&sleeping_list))
-  {
-    return;
-  }
-  else
-  {
-    enum intr_level old_level;
-    old_level = intr_disable();
-    while(!list_empty (&sleeping_list))
-    {
-      t = list_entry (list_front (&sleeping_list), struct thread, s_elem);
-      if (t->ticks_wakeup <= ticks)
-      {
-        thread_unblock (t);
-        list_pop_front (&sleeping_list);
-      }
-      if (t->ticks_wakeup > ticks)
-      {
-        break;
-      }
-    }
-    intr_set_level(old_level); 
-  }
-}
-
-/* priority compare list_less_func. */
-bool
-thread_cmp_priority (const struct list_elem *a, const struct list_elem *b, void *aux UNUSED)
+/* sleep_timeout callback: the thread's wakeup tick has come */
+static void
+sleep_timeout_expired (struct timeout *to UNUSED, void *t_)
 {
-  return list_entry(a, struct thread, elem)->priority > list_entry(b, struct thread, elem)->priority;
+  thread_unblock (t_);
 }
 
-/* put sleeping thread on the sleeping_list */
+/* arm t's sleep timeout to unblock it at t->ticks_wakeup. the timer wheel makes this O(1) */
 void adding_thread_sleeping_list(struct thread *t)
 {
-  enum intr_level old_level;
-  old_level = intr_disable();
-  list_insert_ordered (&sleeping_list, &t->s_elem, (list_less_func *) &wakeup_cmp_priority, NULL);
-  intr_set_level(old_level);
-}
-
-/* ticks_wakeup compare list_less_func. */
-bool wakeup_cmp_priority (const struct list_elem *a, const struct list_elem *b, void *aux UNUSED)
-{
-  return list_entry(a, struct thread, s_elem)->ticks_wakeup < list_entry(b, struct thread, s_elem)->ticks_wakeup;
+  timeout_add (&t->sleep_timeout, t->ticks_wakeup, sleep_timeout_expired, t);
 }
 
 /* a donate priority to b. it is recursive*/
 void priority_donation(struct thread *a, struct thread *b)
 {
   ASSERT(a->priority > b->priority);
-  b->priority = a->priority;
+  thread_change_priority (b, a->priority);
   if (b->lock_waiting != NULL)
   {
     ASSERT(b->status != THREAD_READY);
@@ -850,22 +1388,25 @@ void priority_donation(struct thread *a, struct thread *b)
       }
     }
   }
-  else if (b->status == THREAD_READY)
+  else if (b->rwlock_waiting != NULL)
   {
-    list_remove (&b->elem);
-    list_insert_ordered (&ready_list, &b->elem, (list_less_func *) thread_cmp_priority, NULL);
+    rwlock_donate(b->rwlock_waiting, b);
   }
 }
 
-/* get the mix priority among all locks t is holding, or base_priority if t is not holding any locks */
+/* get the mix priority among all locks and rwlocks t is holding, or base_priority if t is not holding any */
 int get_priority_among_locks_holding(struct thread *t)
 {
   int p = t->base_priority;
-  if (list_empty(&t->locks_holding))
+  struct list_elem* iter;
+  for(iter = list_begin(&t->rwlocks_held);iter != list_end(&t->rwlocks_held);iter = list_next(iter))
   {
-    return p;
+    struct rwlock* rw = list_entry(iter, struct rwlock_hold, thread_elem)->rwlock;
+    if (p < rwlock_get_max_priority(rw))
+    {
+      p = rwlock_get_max_priority(rw);
+    }
   }
-  struct list_elem* iter;
   for(iter = list_begin(&t->locks_holding);iter != list_end(&t->locks_holding);iter = list_next(iter))
   {
     struct lock* l = list_entry(iter, struct lock,loc_elem);
@@ -894,7 +1435,7 @@ void thread_priority_resume(struct thread *t)
       if (l->holder->priority == lock_pre_max_priority)
       {
         thread_pre_priority = l->holder->priority;
-        l->holder->priority = get_priority_among_locks_holding(l->holder);
+        thread_change_priority (l->holder, get_priority_among_locks_holding(l->holder));
         ASSERT(l->holder->priority <= thread_pre_priority);
         if (l->holder->lock_waiting != NULL)//this thread may be donating another thread
         {
@@ -4,8 +4,10 @@
 #include <debug.h>
 #include <list.h>
 #include <stdint.h>
+#include <thread-stats.h>
 #include "threads/synch.h"
 #include "threads/fixed-point.h"
+#include "devices/timeout.h"
 
 /* States in a thread's life cycle. */
 enum thread_status
@@ -26,6 +28,11 @@ typedef int tid_t;
 #define PRI_DEFAULT 31                  /* Default priority. */
 #define PRI_MAX 63                      /* Highest priority. */
 
+/* Stride scheduler tickets. */
+#define TICKETS_MIN 1                   /* Fewest tickets. */
+#define TICKETS_DEFAULT 100             /* Default tickets. */
+#define TICKETS_MAX 10000               /* Most tickets. */
+
 /* A kernel thread or user process.
 
    Each thread structure is stored in its own 4 kB page.  The
@@ -76,12 +83,9 @@ typedef int tid_t;
    the `magic' member of the running thread's `struct thread' is
    set to THREAD_MAGIC.  Stack overflow will normally change this
    value, triggering the assertion. */
-/* The `elem' member has a dual purpose.  It can be an element in
-   the run queue (thread.c), or it can be an element in a
-   semaphore wait list (synch.c).  It can be used these two ways
-   only because they are mutually exclusive: only a thread in the
-   ready state is on the run queue, whereas only a thread in the
-   blocked state is on a semaphore wait list. */
+/* The `elem' member is an element in a run queue (thread.c).
+   Semaphore wait lists (synch.c) are heaps, which use
+   `waiter_elem' instead. */
 struct thread
   {
     /* Owned by thread.c. */
@@ -96,12 +100,30 @@ struct thread
     int nice;                           /* Current nice value */
 
     fixed_point_t recent_cpu;                     /* Current recent CPU value */
+    int recent_cpu_epoch;               /* Second up to which recent_cpu has been decayed */
 
-    /* Shared between thread.c and synch.c. */
-    struct list_elem elem;              /* List element. */
+    /* Owned by thread.c. */
+    struct list_elem elem;              /* Run queue element. */
+    struct heap_elem stride_elem;       /* Run queue element, under -stride. */
+    int tickets;                        /* Share of the CPU, under -stride. */
+    uint64_t pass;                      /* Virtual time used; lowest runs next. */
+    uint64_t pass_remain;               /* Pass ahead of global_pass on blocking. */
+    struct thread_stats stats;          /* Scheduling statistics. */
+
+    /* Real-time (EDF) class, owned by thread.c. */
+    bool rt;                            /* Enrolled in the class? */
+    bool rt_throttled;                  /* Out of budget until next period? */
+    int64_t rt_period;                  /* Reservation period, in ticks... */
+    int64_t rt_budget;                  /* ...and run time allowed in each. */
+    int64_t rt_deadline;                /* End of the current period. */
+    int64_t rt_used;                    /* Ticks run in the current period. */
+    struct heap_elem rt_elem;           /* Real-time run queue element. */
+    struct timeout rt_timeout;          /* Starts the next period. */
+    uint64_t stats_stamp;               /* TSC when last switched in, or
+                                           when last made ready. */
 
     /* Shared between thread.c and timer.c. */
-    struct list_elem s_elem;              /* List element for sleeping_list. */
+    struct timeout sleep_timeout;       /* Wakes the thread from timer_sleep(). */
 
     /* Record at which tick the thread should wake up, initialized to be zero */
     int64_t ticks_wakeup;
@@ -112,8 +134,21 @@ struct thread
     /* the lock that the thread is currently waiting for */
     struct lock *lock_waiting;
 
+    /* rwlocks that the thread is currently holding, and the one it is waiting for */
+    struct rwlock_hold rwlock_holds[RWLOCK_HOLD_MAX]; /* Built-in hold records. */
+    struct list rwlocks_held;           /* Hold records in use. */
+    struct rwlock_hold *rwlock_hold_next; /* Record for the rwlock being acquired. */
+    struct rwlock *rwlock_waiting;
+
     /* Shared between thread.c and synch.c. */
-    struct list_elem loc_elem;              /* List element for threads_waiting. */
+    struct heap_elem loc_elem;              /* Heap element for threads_waiting. */
+
+    /* Owned by synch.c. */
+    struct heap_elem waiter_elem;       /* Heap element for semaphore waiters. */
+    unsigned wait_seq;                  /* Order of arrival among them. */
+    struct semaphore *sema_waiting;     /* Semaphore blocked on, if any. */
+    struct condition *cond_waiting;     /* Condition waited on, if any... */
+    struct heap_elem *cond_elem;        /* ...and our element in its waiters. */
 
 
 #ifdef USERPROG
@@ -130,6 +165,11 @@ struct thread
    Controlled by kernel command-line option "-o mlfqs". */
 extern bool thread_mlfqs;
 
+/* If true, use the stride scheduler, which ignores priorities
+   and shares the CPU in proportion to each thread's tickets.
+   Controlled by kernel command-line option "-stride". */
+extern bool thread_stride;
+
 fixed_point_t load_avg;                       /* Current load average */
 
 void thread_init (void);
@@ -137,12 +177,15 @@ void thread_start (void);
 
 void thread_tick (void);
 void thread_print_stats (void);
+bool thread_get_stats (tid_t, struct thread_stats *);
 
 typedef void thread_func (void *aux);
 tid_t thread_create (const char *name, int priority, thread_func *, void *);
+size_t thread_cache_release (void);
 
 void thread_block (void);
 void thread_unblock (struct thread *);
+bool thread_outranks_current (const struct thread *);
 
 struct thread *thread_current (void);
 tid_t thread_tid (void);
@@ -150,6 +193,7 @@ const char *thread_name (void);
 
 void thread_exit (void) NO_RETURN;
 void thread_yield (void);
+void thread_preempt (void);
 
 /* Performs some operation on thread t, given auxiliary data AUX. */
 typedef void thread_action_func (struct thread *t, void *aux);
@@ -158,23 +202,19 @@ void thread_foreach (thread_action_func *, void *);
 int thread_get_priority (void);
 void thread_set_priority (int);
 
+bool thread_set_realtime (int period, int budget);
+
+int thread_get_tickets (void);
+bool thread_set_tickets (int);
+
 int thread_get_nice (void);
 void thread_set_nice (int);
 int thread_get_recent_cpu (void);
 int thread_get_load_avg (void);
 
-/* if ticks_sleep runs out, unblock the thread, else ticks_sleep minus one */
-void wakeup_sleeping_thread (int64_t ticks);
-
-/* priority compare list_less_func. */
-bool thread_cmp_priority (const struct list_elem *a, const struct list_elem *b, void *aux UNUSED);
-
-/* put sleeping thread on the sleeping_list */
+/* arm t's sleep timeout to unblock it at t->ticks_wakeup */
 void adding_thread_sleeping_list(struct thread *t);
 
-/* ticks_wakeup compare list_less_func. */
-bool wakeup_cmp_priority (const struct list_elem *a, const struct list_elem *b, void *aux UNUSED);
-
 /* a donate priority to b. it is recursive*/
 void priority_donation(struct thread *a, struct thread *b);
 
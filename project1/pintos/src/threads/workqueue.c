@@ -0,0 +1,167 @@
+#include "threads/workqueue.h"
+#include <debug.h>
+#include "threads/interrupt.h"
+#include "threads/thread.h"
+
+/* A worker thread and the work waiting for it. */
+struct workqueue
+  {
+    const char *name;           /* Worker thread name. */
+    int priority;               /* Worker priority... */
+    int nice;                   /* ...or nice value, under MLFQS. */
+    struct list queue;          /* Pending work, oldest first. */
+    struct thread *worker;      /* Worker thread, once started. */
+    bool idle;                  /* True if the worker is blocked
+                                   waiting for work. */
+    struct thread *starter;     /* Thread waiting for the worker to
+                                   start, if any. */
+  };
+
+static struct workqueue queues[WORK_PRI_CNT] =
+  {
+    [WORK_HIGH]    = { "work-high", PRI_MAX, -20 },
+    [WORK_DEFAULT] = { "work", PRI_DEFAULT, 0 },
+    [WORK_LOW]     = { "work-low", PRI_MIN, 20 },
+  };
+
+static thread_func worker;
+
+/* Initializes the work queues and starts their worker threads,
+   waiting until each is up and waiting for work, so that even a
+   low-priority worker is not left sitting in the ready queue. */
+void
+workqueue_init (void)
+{
+  int i;
+
+  for (i = 0; i < WORK_PRI_CNT; i++)
+    {
+      struct workqueue *wq = &queues[i];
+      enum intr_level old_level;
+
+      list_init (&wq->queue);
+      thread_create (wq->name, wq->priority, worker, wq);
+
+      old_level = intr_disable ();
+      while (wq->worker == NULL)
+        {
+          wq->starter = thread_current ();
+          thread_block ();
+        }
+      intr_set_level (old_level);
+    }
+}
+
+/* Initializes W to call FUNC with AUX in the worker thread of
+   the given PRIORITY. */
+void
+work_init (struct work *w, work_func *func, void *aux,
+           enum work_priority priority)
+{
+  ASSERT (w != NULL);
+  ASSERT (func != NULL);
+  ASSERT (priority < WORK_PRI_CNT);
+
+  w->func = func;
+  w->aux = aux;
+  w->priority = priority;
+  w->pending = false;
+}
+
+/* Queues W to run in its worker thread.  May be called from an
+   interrupt handler, in which case a worker of higher priority
+   than the interrupted thread runs as soon as the handler
+   returns.  Returns false, and does nothing, if W was already
+   pending. */
+bool
+work_schedule (struct work *w)
+{
+  struct workqueue *wq;
+  enum intr_level old_level;
+  bool preempt = false;
+
+  ASSERT (w != NULL);
+
+  old_level = intr_disable ();
+  if (w->pending)
+    {
+      intr_set_level (old_level);
+      return false;
+    }
+
+  wq = &queues[w->priority];
+  w->pending = true;
+  list_push_back (&wq->queue, &w->elem);
+  if (wq->idle)
+    {
+      wq->idle = false;
+      thread_unblock (wq->worker);
+      preempt = thread_outranks_current (wq->worker);
+    }
+  intr_set_level (old_level);
+
+  if (preempt)
+    {
+      if (intr_context ())
+        intr_yield_on_return ();
+      else if (old_level == INTR_ON)
+        thread_yield ();
+    }
+  return true;
+}
+
+/* Removes W from its queue.  Returns true if W was pending,
+   false if its function had already started or W was never
+   scheduled. */
+bool
+work_cancel (struct work *w)
+{
+  enum intr_level old_level;
+  bool was_pending;
+
+  ASSERT (w != NULL);
+
+  old_level = intr_disable ();
+  was_pending = w->pending;
+  if (was_pending)
+    {
+      list_remove (&w->elem);
+      w->pending = false;
+    }
+  intr_set_level (old_level);
+  return was_pending;
+}
+
+/* Worker thread for work queue WQ_: runs its work in order,
+   blocking while there is none. */
+static void
+worker (void *wq_)
+{
+  struct workqueue *wq = wq_;
+
+  if (thread_mlfqs)
+    thread_set_nice (wq->nice);
+
+  /* Wake workqueue_init() without yielding to it, so that we
+     block, below, before it goes on. */
+  intr_disable ();
+  wq->worker = thread_current ();
+  if (wq->starter != NULL)
+    thread_unblock (wq->starter);
+  for (;;)
+    {
+      struct work *w;
+
+      while (list_empty (&wq->queue))
+        {
+          wq->idle = true;
+          thread_block ();
+        }
+      w = list_entry (list_pop_front (&wq->queue), struct work, elem);
+      w->pending = false;
+
+      intr_enable ();
+      w->func (w, w->aux);
+      intr_disable ();
+    }
+}
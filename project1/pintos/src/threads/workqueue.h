@@ -0,0 +1,47 @@
+#ifndef THREADS_WORKQUEUE_H
+#define THREADS_WORKQUEUE_H
+
+#include <list.h>
+#include <stdbool.h>
+
+/* Deferred work.
+
+   An interrupt handler that has more to do than it should with
+   interrupts off can instead schedule a work item, whose
+   function then runs in a kernel worker thread.  There is one
+   worker per work priority.  Scheduling work for a worker that
+   outranks the interrupted thread makes the worker run as soon
+   as the handler returns. */
+
+/* Priority of deferred work, which is the priority its worker
+   thread runs at. */
+enum work_priority
+  {
+    WORK_HIGH,                  /* Ahead of every other thread. */
+    WORK_DEFAULT,               /* Among ordinary threads. */
+    WORK_LOW,                   /* Only when little else is ready. */
+    WORK_PRI_CNT
+  };
+
+struct work;
+
+/* Called in its worker thread, with interrupts on, to do work W.
+   It may schedule W again. */
+typedef void work_func (struct work *w, void *aux);
+
+struct work
+  {
+    struct list_elem elem;      /* Element in a worker's queue. */
+    work_func *func;            /* Function to call. */
+    void *aux;                  /* Auxiliary data for FUNC. */
+    enum work_priority priority; /* Worker to run FUNC in. */
+    bool pending;               /* True if scheduled and not yet
+                                   started or cancelled. */
+  };
+
+void workqueue_init (void);
+void work_init (struct work *, work_func *, void *aux, enum work_priority);
+bool work_schedule (struct work *);
+bool work_cancel (struct work *);
+
+#endif /* threads/workqueue.h */
@@ -3,8 +3,11 @@
 #include <syscall-nr.h>
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
 
 static void syscall_handler (struct intr_frame *);
+static bool is_user_buffer (const void *, size_t);
 
 void
 syscall_init (void)
@@ -22,4 +25,38 @@ syscall_handler (struct intr_frame *f UNUSED)
     printf("%s: exit(%d)\n", &thread_current ()->name, args[1]);
     thread_exit();
   }
+  else if (args[0] == SYS_THREAD_STATS) {
+    struct thread_stats stats;
+    struct thread_stats *ustats = (struct thread_stats *) args[2];
+
+    f->eax = false;
+    if (is_user_buffer (ustats, sizeof *ustats)
+        && thread_get_stats ((tid_t) args[1], &stats)) {
+      *ustats = stats;
+      f->eax = true;
+    }
+  }
+  else if (args[0] == SYS_SET_TICKETS) {
+    f->eax = thread_set_tickets ((int) args[1]);
+  }
+  else if (args[0] == SYS_RT_ENROL) {
+    f->eax = thread_set_realtime ((int) args[1], (int) args[2]);
+  }
+}
+
+/* Returns true if the SIZE bytes at UADDR are all mapped user
+   memory of the running process. */
+static bool
+is_user_buffer (const void *uaddr, size_t size)
+{
+  uint32_t *pd = thread_current ()->pagedir;
+  const uint8_t *p = uaddr;
+  const uint8_t *end = p + size;
+
+  if (p == NULL || size == 0 || end < p || !is_user_vaddr (end - 1))
+    return false;
+  for (p = pg_round_down (p); p < end; p += PGSIZE)
+    if (pagedir_get_page (pd, p) == NULL)
+      return false;
+  return true;
 }